@@ -1,6 +1,7 @@
 #include "io.h"
 #include "animation.h"
 #include "render.h"
+#include "kernels.h"
 
 #define LED_PIN 42
 
@@ -13,6 +14,14 @@ Renderer renderer = Renderer(
 // Task handles
 TaskHandle_t renderTaskHandle = NULL;
 
+#define RENDER_TASK_STACK 102400
+
+#ifdef STATIC_ALLOC
+// Render task stack and control block, reserved at link time
+static StackType_t renderTaskStack[RENDER_TASK_STACK];
+static StaticTask_t renderTaskBuffer;
+#endif
+
 /**
  * Render task: Handles LED animation rendering
  * @param parameters Task parameters
@@ -32,6 +41,12 @@ void setup() {
 	while (!Serial) delay(10 / portTICK_PERIOD_MS);
 
 
+#ifdef KERNEL_CHECK
+	const char* failedKernel = checkKernels();
+	if (failedKernel != nullptr) debugf("Kernel %s differs from its reference!\n", failedKernel);
+	else debugln("Pixel kernels match their references");
+#endif
+
 	sdmmcInit();
 	fs::FS& fs = determineFileSystem();
 
@@ -63,11 +78,36 @@ void setup() {
 	vTaskDelay(100 / portTICK_PERIOD_MS);
 	renderer.setRunning(true);
 
+	// Size the staging buffer for the largest frame up front, render() only grows it
+	// while the heap is open and would otherwise leave prefetch off after the seal.
+	// Segments, renderer.setParallelCompose() and FrameTrigger::attachGpio() allocate
+	// too and belong here, before the seal.
+	renderer.frameStager().begin(PREFETCH_MAX_PIXELS, renderer.getCurrentAnimation());
+
 	// Create the render task
+#ifdef STATIC_ALLOC
+	// Everything is in place - flag any allocation from here on. The render task's
+	// stack and control block are static, so creating it does not allocate either.
+	sealHeap();
+
+	renderTaskHandle = xTaskCreateStaticPinnedToCore(
+		renderTask,         // Function to run
+		"RenderTask",       // Task name
+		RENDER_TASK_STACK,  // Stack size (bytes)
+		NULL,               // Task parameters
+		2,                  // Priority (higher than default)
+		renderTaskStack,    // Stack buffer
+		&renderTaskBuffer,  // Task control block
+		1                   // Core to run on (dedicate core 1 to rendering)
+	);
+	if (renderTaskHandle == NULL) {
+		debugln("Failed to create render task!");
+	}
+#else
 	if (xTaskCreatePinnedToCore(
 		renderTask,         // Function to run
 		"RenderTask",       // Task name
-		102400,            // Stack size (bytes)
+		RENDER_TASK_STACK,  // Stack size (bytes)
 		NULL,               // Task parameters
 		2,                  // Priority (higher than default)
 		&renderTaskHandle,  // Task handle;
@@ -75,12 +115,13 @@ void setup() {
   ) != pdPASS) {
     debugln("Failed to create render task!");
 }
+#endif
 }
 
 /**
  * Main loop function
  */
 void loop() {
-    // Main loop is empty since we're using FreeRTOS tasks
-    vTaskDelay(1000000 / portTICK_PERIOD_MS);
+    // Rendering runs in its own task, the main loop only sleeps until a render event arrives
+    renderer.events().dispatch(pdMS_TO_TICKS(1000));
 }
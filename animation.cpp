@@ -1,12 +1,81 @@
 #include "animation.h"
+#include "budget.h"
+#include "spsc.h"
+#include "jsonscan.h"
+#include "animformat.h"
+#include "frameindex.h"
 
 /**
- * @brief Load an animation from a file in the specified file system.
- * @param fs The file system to read from.
- * @param path The path to the animation file.
- * @return An Animation object loaded from the file, or an empty Animation if loading failed.
+ * @brief Frames in flight between the two stages of the pipelined loader
+ */
+#define PIPELINE_QUEUE_FRAMES 16
+
+/**
+ * @brief Bytes the pipelined loader reads from the file at a time
+ */
+#define PIPELINE_READ_BYTES 512
+
+/**
+ * @brief Stack of the frame-building task of the pipelined loader
+ */
+#define PIPELINE_TASK_STACK 8192
+
+/**
+ * @brief Read the optional per-frame timestamps of an animation document
+ * @param doc The parsed document, frames excluded or not
+ * @param animation The animation to give the timeline, with all frames added
+ * @return False if timestamps are present but malformed
+ * @details "timestamps" is a top-level array with the start of every frame in
+ * milliseconds. "duration_ms" in the metadata ends the timeline, by default it
+ * ends at the start of the last frame and the repeat delay holds the last frame.
+ */
+static bool readTimeline(JsonDocument& doc, Animation& animation) {
+    if (doc["timestamps"].isNull()) return true;
+
+    JsonArray timesjson = doc["timestamps"].as<JsonArray>();
+    if (timesjson.isNull()) {
+        debugln("Animation timestamps must be an array");
+        return false;
+    }
+
+    std::vector<uint32_t> frameTimes;
+    frameTimes.reserve(timesjson.size());
+    for (JsonVariant time : timesjson) frameTimes.push_back(time.as<uint32_t>());
+
+    return animation.setTimeline(std::move(frameTimes), doc["metadata"]["duration_ms"] | 0u);
+}
+
+
+/**
+ * @brief Check the metadata of a parsed animation document
+ * @return True if the name, pixel count and frame count are present
+ */
+static bool hasValidMetadata(JsonDocument& doc) {
+    if (!doc["metadata"]["name"].is<std::string>() ||
+    !doc["metadata"]["total_pixels"].is<uint16_t>() ||
+    !doc["metadata"]["frame_count"].is<uint16_t>()) {
+        debugf("Invalid or missing metadata fields in animation JSON.\n");
+        return false;
+    }
+    return true;
+}
+
+
+/**
+ * @brief Read a byte range of the file and append it to a string
  */
-Animation loadAnimation(fs::FS& fs, const std::string& path) {
+static bool readRange(File& file, uint32_t offset, size_t length, std::string& out) {
+    const size_t start = out.size();
+    out.resize(start + length);
+    return length == 0 || (file.seek(offset, fs::SeekSet) && file.read(reinterpret_cast<uint8_t*>(&out[start]), length) == length);
+}
+
+
+/**
+ * @brief Load an animation whose whole document is parsed at once
+ * @details For files without a frames array to index.
+ */
+static Animation loadAnimationDocument(fs::FS& fs, const std::string& path, uint16_t ledLimit) {
     std::string content = readFile(fs, path);
     if (content.empty()) {
         debugf("Failed to read animation file: %s\n", path.c_str());
@@ -31,28 +100,585 @@ Animation loadAnimation(fs::FS& fs, const std::string& path) {
     uint16_t pixelCount = doc["metadata"]["total_pixels"].as<uint16_t>();
     uint16_t frameCount = doc["metadata"]["frame_count"].as<uint16_t>();
 
-    FrameBuffer frames;
-    frames.reserve(frameCount);
-    for (JsonArray framejson : doc["frames"].as<JsonArray>()) {
-        Frame frame;
-        frame.reserve(framejson.size());
+    // Refuse before allocating if the frames cannot fit next to the parsed document
+    JsonArray framesjson = doc["frames"].as<JsonArray>();
+    size_t entries = 0;
+    for (JsonArray framejson : framesjson) entries += framejson.size();
+    const size_t required = sparseBytes(framesjson.size(), entries);
+    if (!heapFits(required)) {
+        debugf("Animation '%s' needs %zu bytes for %zu frames, more than the free heap\n", name.c_str(), required, framesjson.size());
+        return Animation();
+    }
+
+    // Build the frames in place, no intermediate Frame or FrameBuffer copies
+    Animation animation(name);
+    animation.reserveFrames(framesjson.size());
+    for (JsonArray framejson : framesjson) {
+        animation.beginFrame(framejson.size());
         for (JsonArray pixelarray : framejson) {
             if (pixelarray.size() != 4) {
                 debugf("Invalid pixel data format.\n");
                 return Animation();
             }
-            Pixel pixel(
+            animation.addPixel(
                 pixelarray[0].as<uint16_t>(),
                 pixelarray[1].as<uint8_t>(),
                 pixelarray[2].as<uint8_t>(),
                 pixelarray[3].as<uint8_t>()
             );
-            frame.push_back(pixel);
         }
-        frames.push_back(frame);
+        animation.endFrame();
     }
 
-    Animation animation(name, frames);
+    if (!readTimeline(doc, animation)) return Animation();
+
+    animation.freeze(ledLimit);
     debugf("Loaded animation '%s' with %zu frames and a total of %d pixels.\n", name.c_str(), frameCount, pixelCount);
     return animation;
+}
+
+
+/**
+ * @brief Load an animation frame by frame through its index
+ * @param file The open animation file
+ * @param index The frame positions, at least one frame
+ * @param ledLimit Drop pixels at or beyond this LED index
+ * @param animation Set to the loaded animation
+ * @param badFrame Set if a frame could not be read or parsed at its indexed position
+ * @return False if the file cannot be read, a frame or the metadata is malformed or
+ * the frames do not fit the heap
+ * @details Only the text around the frames array and one frame at a time are held
+ * and parsed, never the whole document.
+ */
+static bool loadAnimationIndexed(File& file, const FrameIndex& index, uint16_t ledLimit, Animation& animation, bool& badFrame) {
+    const FrameIndex::Entry& first = index.entries.front();
+    const FrameIndex::Entry& last = index.entries.back();
+    const uint32_t tail = last.offset + last.length;
+
+    // The frames array of the document comes out empty, the metadata and timeline stay
+    std::string document;
+    if (tail > index.fileSize || !readRange(file, 0, first.offset, document) ||
+        !readRange(file, tail, index.fileSize - tail, document)) {
+        return false;
+    }
+
+    JsonDocument doc;
+    DeserializationError error = deserializeJson(doc, document);
+    if (error) {
+        debugf("Failed to parse animation JSON: %s\n", error.c_str());
+        return false;
+    }
+    if (!hasValidMetadata(doc)) return false;
+
+    animation = Animation(doc["metadata"]["name"].as<std::string>());
+    animation.reserveFrames(index.entries.size());
+
+    std::string text;
+    JsonDocument frameDoc;
+    for (const FrameIndex::Entry& entry : index.entries) {
+        text.clear();
+        Frame frame;
+        if (!readRange(file, entry.offset, entry.length, text) || !parseFrameJson(frame, text, frameDoc)) {
+            debugln("Invalid pixel data format.");
+            badFrame = true;
+            return false;
+        }
+        // Checked frame by frame, the pixel count is only known once a frame is parsed
+        if (!heapFits(sparseBytes(1, frame.size()))) {
+            debugf("Animation '%s' does not fit the free heap after %zu frames\n", animation.getName().c_str(), animation.frameCount());
+            return false;
+        }
+        normalizeFrame(frame, ledLimit);
+        animation.appendFrame(std::move(frame));
+    }
+
+    if (!readTimeline(doc, animation)) return false;
+
+    animation.freeze(ledLimit);
+    debugf("Loaded animation '%s' with %zu frames and a total of %d pixels.\n",
+        animation.getName().c_str(), animation.frameCount(), doc["metadata"]["total_pixels"].as<uint16_t>());
+    return true;
+}
+
+
+/**
+ * @brief Load an animation from a file in the specified file system.
+ * @param fs The file system to read from.
+ * @param path The path to the animation file.
+ * @param ledLimit Drop pixels at or beyond this LED index.
+ * @return An Animation object loaded from the file, or an empty Animation if loading failed.
+ * @details JSON files are read through their sidecar frame index, or an index built by
+ * a scan if there is none. A frame that does not parse through the index has the index
+ * removed and rebuilt by a scan, and the load tried once more.
+ */
+Animation loadAnimation(fs::FS& fs, const std::string& path, uint16_t ledLimit) {
+    // Files written by the host optimizer skip JSON parsing entirely
+    const size_t suffixLength = strlen(ANIM_FILE_SUFFIX);
+    if (path.size() > suffixLength && path.compare(path.size() - suffixLength, suffixLength, ANIM_FILE_SUFFIX) == 0) {
+        return loadAnimationBinary(fs, path, ledLimit);
+    }
+
+    FrameIndex index;
+    if (!openFrameIndex(fs, path, index) || index.entries.empty()) return loadAnimationDocument(fs, path, ledLimit);
+
+    for (int attempt = 0; attempt < 2; attempt++) {
+        File file = fs.open(path.c_str(), FILE_READ);
+        if (!file || file.isDirectory()) {
+            debugf("Failed to read animation file: %s\n", path.c_str());
+            return Animation();
+        }
+
+        Animation animation;
+        bool badFrame = false;
+        const bool loaded = loadAnimationIndexed(file, index, ledLimit, animation, badFrame);
+        file.close();
+        if (loaded) return animation;
+        if (!badFrame || attempt > 0) break;
+
+        // The offsets may predate an edit the index could not detect
+        debugf("Rebuilding the frame index of %s\n", path.c_str());
+        removeFrameIndex(fs, path);
+        if (!buildFrameIndex(fs, path, index) || index.entries.empty()) break;
+#ifdef SAVE_FRAME_INDEX
+        saveFrameIndex(fs, path, index);
+#endif
+    }
+
+    debugf("Failed to load animation %s\n", path.c_str());
+    return Animation();
+}
+
+
+/**
+ * @brief State shared by the two stages of the pipelined loader
+ */
+struct LoadPipeline {
+    SpscQueue<std::string, PIPELINE_QUEUE_FRAMES> queue;    // Frame JSON text, reader to builder
+    Animation* animation = nullptr;                         // Frames are built in place here
+    std::shared_ptr<Animation> shared;                      // Keeps a progressive animation alive
+    bool progressive = false;                               // Publish frames as they are built
+    bool useIndex = true;                                   // Read frames at the offsets of a current sidecar index
+    bool indexed = false;                                   // Frames were read at the offsets of the sidecar index
+    fs::FS* fs = nullptr;
+    std::string path;
+    std::string document;                                   // Everything but the frames
+    TaskHandle_t reader = nullptr;                          // Task running the reader stage
+    TaskHandle_t builder = nullptr;                         // Task running the builder stage
+    std::shared_ptr<std::atomic<TaskHandle_t>> waiter;      // Caller waiting for the first progressive frame, outlives the pipeline
+    std::atomic<bool> readerDone{false};                    // No more frames will be queued
+    std::atomic<bool> builderDone{false};                   // The builder has exited
+    std::atomic<bool> failed{false};                        // A frame or the metadata was malformed
+    uint16_t ledLimit = UINT16_MAX;                         // Pixels at or beyond this index are dropped
+};
+
+
+void normalizeFrame(Frame& frame, uint16_t ledLimit) {
+    bool normal = true;
+    for (size_t i = 0; i < frame.size() && normal; i++) {
+        normal = frame[i].index < ledLimit && (i == 0 || frame[i].index > frame[i - 1].index);
+    }
+    if (normal) return;
+
+    // Pixel assignment keeps the index, so sort positions and copy-construct a new frame
+    std::vector<uint32_t> order;
+    order.reserve(frame.size());
+    for (size_t i = 0; i < frame.size(); i++) {
+        if (frame[i].index < ledLimit) order.push_back(i);
+    }
+    std::stable_sort(order.begin(), order.end(), [&frame](uint32_t a, uint32_t b) {
+        return frame[a].index < frame[b].index;
+    });
+
+    Frame normalized;
+    normalized.reserve(order.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        // Stable, so the last pixel of a run of repeats is the last write
+        if (i + 1 < order.size() && frame[order[i + 1]].index == frame[order[i]].index) continue;
+        normalized.push_back(frame[order[i]]);
+    }
+    normalized.shrink_to_fit();
+    frame.swap(normalized);
+}
+
+
+bool parseFrameJson(Frame& frame, const std::string& json, JsonDocument& doc) {
+    if (deserializeJson(doc, json)) return false;
+
+    JsonArray framejson = doc.as<JsonArray>();
+    frame.clear();
+    frame.reserve(framejson.size());
+    for (JsonArray pixelarray : framejson) {
+        if (pixelarray.size() != 4) return false;
+        frame.emplace_back(
+            pixelarray[0].as<uint16_t>(),
+            pixelarray[1].as<uint8_t>(),
+            pixelarray[2].as<uint8_t>(),
+            pixelarray[3].as<uint8_t>()
+        );
+    }
+    return true;
+}
+
+
+/**
+ * @brief Wake the caller of a progressive load if it is still waiting
+ * @details Taking the handle makes this the only notification of the load, and none is
+ * sent once loadAnimationProgressive() has cleared it on return.
+ */
+static void notifyWaiter(LoadPipeline& pipeline) {
+    TaskHandle_t waiter = pipeline.waiter->exchange(nullptr, std::memory_order_acq_rel);
+    if (waiter) xTaskNotifyGive(waiter);
+}
+
+
+/**
+ * @brief Builder stage: pops frame text, converts pixels and appends or publishes frames
+ * @param parameters The LoadPipeline
+ */
+static void buildFramesTask(void* parameters) {
+    LoadPipeline* pipeline = static_cast<LoadPipeline*>(parameters);
+
+    {
+        std::string chunk;
+        JsonDocument doc;
+        while (true) {
+            if (pipeline->queue.pop(chunk)) {
+                xTaskNotifyGive(pipeline->reader);    // Room for the reader again
+                if (pipeline->failed.load(std::memory_order_relaxed)) continue;
+
+                Frame frame;
+                if (!parseFrameJson(frame, chunk, doc)) {
+                    debugln("Invalid pixel data format.");
+                    pipeline->failed.store(true, std::memory_order_relaxed);
+                    continue;
+                }
+
+                if (pipeline->progressive) {
+                    // Normalized by publishFrame() with the same limit
+                    pipeline->animation->publishFrame(std::move(frame));
+                    if (pipeline->animation->readyFrameCount() == 1) notifyWaiter(*pipeline);
+                } else {
+                    normalizeFrame(frame, pipeline->ledLimit);
+                    pipeline->animation->appendFrame(std::move(frame));
+                }
+                continue;
+            }
+
+            if (pipeline->readerDone.load(std::memory_order_acquire) && pipeline->queue.empty()) break;
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(10));
+        }
+    }
+
+    // The reader may free the pipeline once this is stored, do not touch it afterwards
+    TaskHandle_t reader = pipeline->reader;
+    pipeline->builderDone.store(true, std::memory_order_release);
+    xTaskNotifyGive(reader);
+    vTaskDelete(NULL);
+}
+
+
+/**
+ * @brief Size and publish a progressive animation from the metadata read so far
+ * @param pipeline The pipeline, with the document up to the start of the frames array
+ * @return False if the metadata does not come before the frames or is invalid
+ */
+static bool startProgressive(LoadPipeline& pipeline) {
+    JsonDocument doc;
+    if (deserializeJson(doc, pipeline.document + "]}") || !hasValidMetadata(doc)) {
+        debugln("Progressive loading needs the metadata before the frames");
+        return false;
+    }
+
+    pipeline.animation->beginProgressive(
+        doc["metadata"]["name"].as<std::string>(),
+        doc["metadata"]["frame_count"].as<uint16_t>(),
+        pipeline.ledLimit
+    );
+    return true;
+}
+
+
+/**
+ * @brief Queue one frame's JSON text for the builder
+ */
+static void queueFrame(LoadPipeline& pipeline, std::string&& frame) {
+    while (!pipeline.queue.push(std::move(frame))) ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(10));
+    xTaskNotifyGive(pipeline.builder);
+}
+
+
+/**
+ * @brief Tell the builder no more frames come and wait for it to exit
+ */
+static void finishReading(LoadPipeline& pipeline) {
+    pipeline.readerDone.store(true, std::memory_order_release);
+    xTaskNotifyGive(pipeline.builder);
+    while (!pipeline.builderDone.load(std::memory_order_acquire)) ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(10));
+}
+
+
+/**
+ * @brief Reader stage through a frame index: read each frame's text at its offset
+ * @param pipeline The pipeline, its builder must already be running
+ * @param file The open animation file
+ * @param index The frame positions, at least one frame
+ * @return True if every frame was read
+ * @details Skips scanning the file character by character. The document is the text
+ * before the first frame and after the last one, the separators between frames are
+ * not needed.
+ */
+static bool readFramesIndexed(LoadPipeline& pipeline, File& file, const FrameIndex& index) {
+    const FrameIndex::Entry& first = index.entries.front();
+    const FrameIndex::Entry& last = index.entries.back();
+    bool ok = readRange(file, 0, first.offset, pipeline.document);
+    if (ok && pipeline.progressive) ok = startProgressive(pipeline);
+
+    for (size_t i = 0; ok && i < index.entries.size() && !pipeline.failed.load(std::memory_order_relaxed); i++) {
+        std::string frame;
+        ok = readRange(file, index.entries[i].offset, index.entries[i].length, frame);
+        if (ok) queueFrame(pipeline, std::move(frame));
+    }
+
+    // A timeline after the frames is only read by the pipelined loader, not progressively
+    const uint32_t tail = last.offset + last.length;
+    if (ok && !pipeline.progressive) ok = tail <= index.fileSize && readRange(file, tail, index.fileSize - tail, pipeline.document);
+
+    if (!ok) pipeline.failed.store(true, std::memory_order_relaxed);
+    finishReading(pipeline);
+    return ok;
+}
+
+
+/**
+ * @brief Reader stage: read the file and queue each frame's JSON text
+ * @param pipeline The pipeline, its builder must already be running
+ * @param file The open animation file
+ * @return The scanner result: true if the whole frames array was read
+ * @details With a current sidecar index the frames are read at their offsets. Without
+ * one the file is scanned, and with SAVE_FRAME_INDEX the frame positions found are saved
+ * as the sidecar so the next load of the file can seek.
+ */
+static bool readFrames(LoadPipeline& pipeline, File& file) {
+    FrameIndex index;
+    if (pipeline.useIndex && findFrameIndex(*pipeline.fs, pipeline.path, index) && !index.entries.empty()) {
+        pipeline.indexed = true;
+        return readFramesIndexed(pipeline, file, index);
+    }
+    index.fileSize = file.size();
+    index.lastWrite = static_cast<uint32_t>(file.getLastWrite());
+
+    JsonFrameScanner scanner;
+    std::string frame;
+    char buffer[PIPELINE_READ_BYTES];
+    bool started = !pipeline.progressive;
+    uint32_t position = 0;
+
+    while (file.available() && !pipeline.failed.load(std::memory_order_relaxed)) {
+        const size_t length = file.read(reinterpret_cast<uint8_t*>(buffer), sizeof(buffer));
+        if (length == 0) break;
+
+        for (size_t i = 0; i < length; i++, position++) {
+            switch (scanner.feed(buffer[i])) {
+                case JsonFrameScanner::Role::Document:
+                    pipeline.document += buffer[i];
+                    break;
+                case JsonFrameScanner::Role::FrameBegin:
+                    if (!started) {
+                        started = startProgressive(pipeline);
+                        if (!started) pipeline.failed.store(true, std::memory_order_relaxed);
+                    }
+                    index.entries.push_back({position, 0});
+                    frame.clear();
+                    frame += buffer[i];
+                    break;
+                case JsonFrameScanner::Role::Frame:
+                    frame += buffer[i];
+                    break;
+                case JsonFrameScanner::Role::FrameEnd:
+                    frame += buffer[i];
+                    index.entries.back().length = position + 1 - index.entries.back().offset;
+                    queueFrame(pipeline, std::move(frame));
+                    frame = std::string();
+                    break;
+                case JsonFrameScanner::Role::Separator:
+                    break;
+            }
+        }
+    }
+
+    finishReading(pipeline);
+    if (!scanner.framesComplete()) return false;
+#ifdef SAVE_FRAME_INDEX
+    if (!pipeline.failed.load(std::memory_order_relaxed)) saveFrameIndex(*pipeline.fs, pipeline.path, index);
+#endif
+    return true;
+}
+
+
+/**
+ * @brief Start the builder stage on the core the caller is not running on
+ * @return True if the task was created
+ */
+static bool startBuilder(LoadPipeline& pipeline) {
+    const BaseType_t otherCore = xPortGetCoreID() == 0 ? 1 : 0;
+    return xTaskCreatePinnedToCore(buildFramesTask, "FrameBuilder", PIPELINE_TASK_STACK, &pipeline, 1, &pipeline.builder, otherCore) == pdPASS;
+}
+
+
+/**
+ * @brief The pipelined loader
+ * @param useIndex Read the frames through a current sidecar index, otherwise scan the file
+ */
+static Animation loadPipelined(fs::FS& fs, const std::string& path, uint16_t ledLimit, bool useIndex) {
+    File file = fs.open(path.c_str(), FILE_READ);
+    if (!file || file.isDirectory()) {
+        debugf("Failed to open animation file: %s\n", path.c_str());
+        return Animation();
+    }
+
+    Animation animation("LOADING");
+    LoadPipeline pipeline;
+    pipeline.animation = &animation;
+    pipeline.reader = xTaskGetCurrentTaskHandle();
+    pipeline.fs = &fs;
+    pipeline.path = path;
+    pipeline.ledLimit = ledLimit;
+    pipeline.useIndex = useIndex;
+
+    if (!startBuilder(pipeline)) {
+        debugln("Failed to create the frame builder task, loading on one core");
+        file.close();
+        return loadAnimation(fs, path, ledLimit);
+    }
+
+    // Reader stage runs right here: cut frames out of the text, keep the rest for the metadata
+    const bool complete = readFrames(pipeline, file);
+    file.close();
+
+    if (pipeline.failed.load(std::memory_order_relaxed) || !complete) {
+        if (pipeline.indexed) {
+            // The offsets may predate an edit the index could not detect, scanning rebuilds it
+            debugf("Loading %s through its frame index failed, scanning it again\n", path.c_str());
+            animation = Animation();
+            return loadPipelined(fs, path, ledLimit, false);
+        }
+        debugf("Failed to load animation frames from %s\n", path.c_str());
+        return Animation();
+    }
+
+    JsonDocument doc;
+    DeserializationError error = deserializeJson(doc, pipeline.document);
+    if (error) {
+        debugf("Failed to parse animation JSON: %s\n", error.c_str());
+        return Animation();
+    }
+    if (!hasValidMetadata(doc)) return Animation();
+
+    std::string name = doc["metadata"]["name"].as<std::string>();
+    uint16_t pixelCount = doc["metadata"]["total_pixels"].as<uint16_t>();
+
+    animation.setName(name);
+    if (!readTimeline(doc, animation)) return Animation();
+    animation.freeze(ledLimit);
+    debugf("Loaded animation '%s' with %zu frames and a total of %d pixels on two cores.\n", name.c_str(), animation.frameCount(), pixelCount);
+    return animation;
+}
+
+
+Animation loadAnimationPipelined(fs::FS& fs, const std::string& path, uint16_t ledLimit) {
+    return loadPipelined(fs, path, ledLimit, true);
+}
+
+
+/**
+ * @brief Reader stage of a progressive load, running in its own task
+ * @param parameters The LoadPipeline, owned and freed by this task
+ */
+static void progressiveReaderTask(void* parameters) {
+    LoadPipeline* pipeline = static_cast<LoadPipeline*>(parameters);
+
+    // Wait until the builder exists, the reader notifies it
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+    {
+        File file = pipeline->fs->open(pipeline->path.c_str(), FILE_READ);
+        bool complete = false;
+        if (file && !file.isDirectory()) {
+            complete = readFrames(*pipeline, file);
+            file.close();
+        } else {
+            debugf("Failed to open animation file: %s\n", pipeline->path.c_str());
+            pipeline->failed.store(true, std::memory_order_relaxed);
+            finishReading(*pipeline);
+        }
+
+        Animation& animation = *pipeline->animation;
+        animation.finishProgressive();
+        if (pipeline->failed.load(std::memory_order_relaxed) || !complete) {
+            // Published frames cannot be taken back, the next load scans the file instead
+            if (pipeline->indexed) removeFrameIndex(*pipeline->fs, pipeline->path);
+            debugf("Progressive load of %s stopped after %zu frames\n", pipeline->path.c_str(), animation.readyFrameCount());
+        } else {
+            debugf("Loaded animation '%s' with %zu frames progressively.\n", animation.getName().c_str(), animation.readyFrameCount());
+        }
+
+        // Wake the caller in case it is still waiting for a first frame that never came
+        notifyWaiter(*pipeline);
+        delete pipeline;
+    }
+
+    vTaskDelete(NULL);
+}
+
+
+std::shared_ptr<const Animation> loadAnimationProgressive(fs::FS& fs, const std::string& path, uint16_t ledLimit) {
+    std::shared_ptr<Animation> animation = std::make_shared<Animation>("LOADING");
+
+    LoadPipeline* pipeline = new LoadPipeline();
+    pipeline->animation = animation.get();
+    pipeline->shared = animation;
+    pipeline->progressive = true;
+    pipeline->fs = &fs;
+    pipeline->path = path;
+    pipeline->ledLimit = ledLimit;
+    std::shared_ptr<std::atomic<TaskHandle_t>> waiter = std::make_shared<std::atomic<TaskHandle_t>>(xTaskGetCurrentTaskHandle());
+    pipeline->waiter = waiter;
+
+    if (xTaskCreatePinnedToCore(progressiveReaderTask, "FrameReader", PIPELINE_TASK_STACK, pipeline, 1, &pipeline->reader, xPortGetCoreID()) != pdPASS) {
+        debugln("Failed to create the frame reader task");
+        delete pipeline;
+        return nullptr;
+    }
+
+    if (!startBuilder(*pipeline)) {
+        // The reader is still parked on its start notification and owns nothing yet
+        debugln("Failed to create the frame builder task");
+        vTaskDelete(pipeline->reader);
+        delete pipeline;
+        return nullptr;
+    }
+    xTaskNotifyGive(pipeline->reader);
+
+    // Return as soon as there is something to play, or the loader gave up
+    bool notified = false;
+    while (animation->readyFrameCount() == 0 && (animation->isLoading() || !animation->isFrozen())) {
+        if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(10)) > 0) {
+            notified = true;
+        } else if (animation.use_count() == 1) {
+            break;
+        }
+    }
+
+    // No notification after this returns; one already on its way is taken here instead
+    if (waiter->exchange(nullptr, std::memory_order_acq_rel) == nullptr && !notified) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    }
+
+    if (animation->readyFrameCount() == 0) {
+        debugf("Failed to load a first frame from %s\n", path.c_str());
+        return nullptr;
+    }
+
+    debugf("First frame of '%s' ready, loading the rest in the background\n", animation->getName().c_str());
+    return animation;
 }
\ No newline at end of file
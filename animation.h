@@ -7,6 +7,7 @@
 #include <Arduino.h>
 #include <vector>
 #include <mutex>
+#include <atomic>
 #include <memory>
 #include <array>
 #include <string>
@@ -47,32 +48,167 @@ struct Pixel {
 using Frame = std::vector<Pixel>;
 using FrameBuffer = std::vector<Frame>;
 
+/**
+ * @brief The range of LEDs a frame writes to
+ * @details first and last bound the touched indices. Each bit of the occupancy
+ * mask covers 32 consecutive LEDs, indices past the last block share its bit,
+ * so a frame that only lights a few regions of a long strip is rejected
+ * for any window that falls between them.
+ */
+struct FrameBounds {
+    static constexpr uint8_t blockShift = 5;    // 32 LEDs per occupancy bit
+    static constexpr uint8_t lastBlock = 63;
+
+    uint16_t first = UINT16_MAX;    // Lowest LED index in the frame
+    uint16_t last = 0;              // Highest LED index in the frame
+    uint64_t occupancy = 0;         // Blocks of LEDs the frame touches
+    bool sorted = true;             // Indices never decrease, repeated indices are adjacent
+
+    /**
+     * @brief Measure a frame
+     */
+    static FrameBounds of(const Frame& frame) {
+        FrameBounds bounds;
+        for (const Pixel& pixel : frame) bounds.add(pixel.index);
+        return bounds;
+    }
+
+    void add(uint16_t index) {
+        if (!empty() && index < last) sorted = false;
+        first = std::min(first, index);
+        last = std::max(last, index);
+        occupancy |= 1ULL << std::min<uint16_t>(index >> blockShift, lastBlock);
+    }
+
+    /**
+     * @brief Checks if the frame touches no LED at all
+     */
+    bool empty() const {
+        return occupancy == 0;
+    }
+
+    /**
+     * @brief Checks if every index of the frame is below end
+     * @details Writers use it to drop the per-pixel range check.
+     */
+    bool within(uint32_t end) const {
+        return empty() || last < end;
+    }
+
+    /**
+     * @brief Checks if the frame may touch an LED in [start, start + length)
+     * @details Exact for the first/last bounds, coarse within them.
+     */
+    bool touches(uint32_t start, uint32_t length) const {
+        if (empty() || length == 0) return false;
+        const uint32_t end = start + length - 1;
+        if (last < start || first > end) return false;
+
+        const uint32_t lo = std::min<uint32_t>(start >> blockShift, lastBlock);
+        const uint32_t hi = std::min<uint32_t>(end >> blockShift, lastBlock);
+        const uint64_t upper = hi == lastBlock ? ~0ULL : (1ULL << (hi + 1)) - 1;
+        return (occupancy & upper & ~((1ULL << lo) - 1)) != 0;
+    }
+};
+
+/**
+ * @brief Sort a frame by LED index, keep the last write of repeated indices and drop
+ * indices at or beyond ledLimit
+ * @param frame The frame to normalize in place
+ * @param ledLimit The first LED index to drop
+ * @details Drawing the result gives the same output as drawing the frame as written,
+ * but the writes are in ascending order and writers can cut off the LEDs beyond the
+ * strip with one search. Frames that are already normal are only scanned.
+ */
+void normalizeFrame(Frame& frame, uint16_t ledLimit = UINT16_MAX);
+
+/**
+ * @brief Identifier of an animation: the djb2 hash of its name
+ */
+using AnimationId = uint32_t;
+
+/**
+ * @brief Compile-time djb2 hash of an animation name
+ * @param str The name
+ * @param length The length of the name
+ * @return The same value Animation::getNameHash() returns for that name
+ */
+constexpr AnimationId hashAnimationName(const char* str, size_t length) {
+    uint32_t hash = 5381;
+    for (size_t i = 0; i < length; i++) {
+        hash = ((hash << 5) + hash) + static_cast<uint32_t>(str[i]);
+    }
+    return hash;
+}
+
+/**
+ * @brief Animation id literal, e.g. "blink"_anim, evaluated at compile time
+ */
+constexpr AnimationId operator""_anim(const char* str, size_t length) {
+    return hashAnimationName(str, length);
+}
+
 struct Animation {
 private:
     std::string name_;
     uint32_t nameHash_;
     FrameBuffer frames_;
+    std::vector<FrameBounds> bounds_;           // Per-frame bounds, measured when frozen
+    std::vector<uint32_t> frameTimes_;          // Start of each frame in ms, empty for fixed-delay playback
+    uint32_t durationMs_ = 0;                   // End of the timeline in ms
+    bool building_ = false;
+    std::atomic<bool> frozen_{false};
+    std::atomic<bool> progressive_{false};      // Frames are published one by one by a loader
+    std::atomic<bool> loading_{false};          // The loader is still publishing frames
+    std::atomic<size_t> readyFrames_{0};        // Frames published so far when progressive
+    uint16_t ledLimit_ = UINT16_MAX;            // Pixels publishFrame() drops, at or beyond this index
     mutable std::mutex mutex_;
 
+    /**
+     * @brief Checks if reads can skip the mutex
+     * @details Pairs with the release store in freeze(), so everything written
+     * before the animation was frozen is visible to the reader.
+     */
+    bool readsAreLockFree() const {
+        return frozen_.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Checks if a mutation has to be refused
+     * @param operation The name of the mutation, for the log
+     * @details Must be called with the mutex held.
+     */
+    bool rejectIfFrozen(const char* operation) const {
+        if (!frozen_.load(std::memory_order_relaxed)) return false;
+        debugf("Animation '%s' is frozen, %s() ignored\n", name_.c_str(), operation);
+        return true;
+    }
+
 public:
     Animation() : name_("NONE"), nameHash_(hash_string_runtime("NONE")) {}
 
     Animation(
         const std::string& namestr,
-        const FrameBuffer& frames = FrameBuffer()
+        const FrameBuffer& frames
     ) : name_(namestr), nameHash_(hash_string_runtime(namestr)), frames_(frames) {}
 
+    /**
+     * @brief Constructor taking ownership of the frames
+     * @param namestr The name of the animation
+     * @param frames The frames to move in, left empty afterwards
+     */
+    Animation(
+        const std::string& namestr,
+        FrameBuffer&& frames
+    ) : name_(namestr), nameHash_(hash_string_runtime(namestr)), frames_(std::move(frames)) {}
+
     /**
      * @brief Fast runtime string hashing for animation name comparisons
      * @param str The string to hash
      * @return The hash of the string
      */
     inline uint32_t hash_string_runtime(const std::string& str) {
-        uint32_t hash = 5381;
-        for (size_t i = 0; i < str.length(); i++) {
-            hash = ((hash << 5) + hash) + str[i];
-        }
-        return hash;
+        return hashAnimationName(str.data(), str.length());
     }
 
     /**
@@ -101,6 +237,12 @@ public:
         name_ = other.name_;
         nameHash_ = other.nameHash_;
         frames_ = other.frames_;
+        bounds_ = other.bounds_;
+        frameTimes_ = other.frameTimes_;
+        durationMs_ = other.durationMs_;
+        frozen_.store(other.frozen_.load(std::memory_order_acquire), std::memory_order_release);
+        progressive_.store(other.progressive_.load(std::memory_order_acquire), std::memory_order_relaxed);
+        readyFrames_.store(other.readyFrames_.load(std::memory_order_acquire), std::memory_order_relaxed);
         debugf("Animation '%s' copied\n", name_.c_str());
     }
 
@@ -109,7 +251,9 @@ public:
      * @brief Copy assignment operator
      * @param other The animation to copy
      * @return A reference to the copied animation
-     * @details Copies the name and frames from the other animation
+     * @details Copies the name, frames and frozen state from the other animation.
+     * This replaces a frozen animation too, so the owner must make sure no other
+     * task is reading it at the time.
      */
     Animation &operator=(const Animation &other) {
         if (this == &other) return *this;
@@ -122,6 +266,12 @@ public:
         name_ = other.name_;
         nameHash_ = other.nameHash_;
         frames_ = other.frames_;
+        bounds_ = other.bounds_;
+        frameTimes_ = other.frameTimes_;
+        durationMs_ = other.durationMs_;
+        frozen_.store(other.frozen_.load(std::memory_order_acquire), std::memory_order_release);
+        progressive_.store(other.progressive_.load(std::memory_order_acquire), std::memory_order_relaxed);
+        readyFrames_.store(other.readyFrames_.load(std::memory_order_acquire), std::memory_order_relaxed);
         return *this;
     }
 
@@ -136,6 +286,12 @@ public:
         name_ = std::move(other.name_);
         nameHash_ = other.nameHash_;
         frames_ = std::move(other.frames_);
+        bounds_ = std::move(other.bounds_);
+        frameTimes_ = std::move(other.frameTimes_);
+        durationMs_ = other.durationMs_;
+        frozen_.store(other.frozen_.load(std::memory_order_acquire), std::memory_order_release);
+        progressive_.store(other.progressive_.load(std::memory_order_acquire), std::memory_order_relaxed);
+        readyFrames_.store(other.readyFrames_.load(std::memory_order_acquire), std::memory_order_relaxed);
     }
 
 
@@ -154,6 +310,12 @@ public:
         name_ = std::move(other.name_);
         nameHash_ = other.nameHash_;
         frames_ = std::move(other.frames_);
+        bounds_ = std::move(other.bounds_);
+        frameTimes_ = std::move(other.frameTimes_);
+        durationMs_ = other.durationMs_;
+        frozen_.store(other.frozen_.load(std::memory_order_acquire), std::memory_order_release);
+        progressive_.store(other.progressive_.load(std::memory_order_acquire), std::memory_order_relaxed);
+        readyFrames_.store(other.readyFrames_.load(std::memory_order_acquire), std::memory_order_relaxed);
         return *this;
     }
 
@@ -163,6 +325,7 @@ public:
      * @return The name of the animation
      */
     const std::string& getName() const{
+        if (readsAreLockFree()) return name_;
         std::lock_guard<std::mutex> lock(mutex_);
         return name_;
     }
@@ -174,6 +337,7 @@ public:
      */
     void setName(const std::string& namestr) {
         std::lock_guard<std::mutex> lock(this->mutex_);
+        if (rejectIfFrozen("setName")) return;
         name_ = namestr;
         nameHash_ = hash_string_runtime(namestr);
     }
@@ -184,6 +348,7 @@ public:
      * @return The hash of the animation name
      */
     uint32_t getNameHash() const {
+        if (readsAreLockFree()) return nameHash_;
         std::lock_guard<std::mutex> lock(mutex_);
         return nameHash_;
     }
@@ -194,6 +359,7 @@ public:
      * @return The number of frames in the animation
      */
     size_t frameCount() const {
+        if (readsAreLockFree()) return frames_.size();
         std::lock_guard<std::mutex> lock(this->mutex_);
         return frames_.size();
     }
@@ -201,10 +367,197 @@ public:
 
     void setFrames(const FrameBuffer& frames) {
         std::lock_guard<std::mutex> lock(mutex_);
+        if (rejectIfFrozen("setFrames")) return;
         debugf("Setting %zu frames for animation '%s'\n", frames.size(), name_.c_str());
         frames_ = frames;
     }
 
+    /**
+     * @brief Take ownership of a frame buffer without copying it
+     * @param frames The frames to move in, left empty afterwards
+     */
+    void setFrames(FrameBuffer&& frames) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (rejectIfFrozen("setFrames")) return;
+        debugf("Moving %zu frames into animation '%s'\n", frames.size(), name_.c_str());
+        frames_ = std::move(frames);
+    }
+
+
+    /**
+     * @brief Reserve room for frames that will be built in place
+     * @param count The expected number of frames
+     */
+    void reserveFrames(size_t count) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (rejectIfFrozen("reserveFrames")) return;
+        frames_.reserve(count);
+    }
+
+
+    /**
+     * @brief Start building a new frame in place at the end of the animation
+     * @param expectedPixels The expected number of pixels in the frame
+     */
+    void beginFrame(size_t expectedPixels = 0) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (rejectIfFrozen("beginFrame")) return;
+        frames_.emplace_back();
+        frames_.back().reserve(expectedPixels);
+        building_ = true;
+    }
+
+
+    /**
+     * @brief Append a pixel to the frame being built
+     * @param pixel The pixel to append
+     */
+    void addPixel(const Pixel& pixel) {
+        addPixel(pixel.index, pixel.r, pixel.g, pixel.b);
+    }
+
+
+    /**
+     * @brief Append a pixel to the frame being built
+     * @param index The LED index
+     * @param r The red value
+     * @param g The green value
+     * @param b The blue value
+     */
+    void addPixel(uint16_t index, uint8_t r, uint8_t g, uint8_t b) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (rejectIfFrozen("addPixel")) return;
+        if (!building_) {
+            debugln("addPixel() called outside beginFrame()/endFrame()");
+            return;
+        }
+        frames_.back().emplace_back(index, r, g, b);
+    }
+
+
+    /**
+     * @brief Finish the frame being built
+     */
+    void endFrame() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        building_ = false;
+    }
+
+
+    /**
+     * @brief Append a complete frame without copying it
+     * @param frame The frame to move in
+     */
+    void appendFrame(Frame&& frame) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (rejectIfFrozen("appendFrame")) return;
+        frames_.push_back(std::move(frame));
+    }
+
+
+    /**
+     * @brief Publish the animation for playback before its frames are loaded
+     * @param namestr The name of the animation
+     * @param totalFrames The number of frames the loader will publish
+     * @param ledLimit Drop pixels at or beyond this LED index, as freeze() does
+     * @details Sizes the frame table once, so it never moves while it is read, and
+     * freezes the animation. Frames then become visible one at a time through
+     * publishFrame(), in order.
+     */
+    void beginProgressive(const std::string& namestr, size_t totalFrames, uint16_t ledLimit = UINT16_MAX) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (rejectIfFrozen("beginProgressive")) return;
+        name_ = namestr;
+        ledLimit_ = ledLimit;
+        nameHash_ = hash_string_runtime(namestr);
+        frames_.clear();
+        frames_.resize(totalFrames);
+        bounds_.assign(totalFrames, FrameBounds());
+        readyFrames_.store(0, std::memory_order_relaxed);
+        loading_.store(true, std::memory_order_relaxed);
+        progressive_.store(true, std::memory_order_relaxed);
+        frozen_.store(true, std::memory_order_release);
+    }
+
+
+    /**
+     * @brief Publish the next frame of a progressive animation
+     * @param frame The frame to move in
+     * @return False if the animation is not progressive or all frames are published
+     * @details Called by the loader only. The frame is normalized with the limit given
+     * to beginProgressive(), so the loader need not do it first. The frame is stored
+     * before the ready count is released, so readers below the ready count never see
+     * a frame being written.
+     */
+    bool publishFrame(Frame&& frame) {
+        if (!loading_.load(std::memory_order_acquire)) return false;
+        const size_t index = readyFrames_.load(std::memory_order_relaxed);
+        if (index >= frames_.size()) return false;
+        normalizeFrame(frame, ledLimit_);
+        bounds_[index] = FrameBounds::of(frame);
+        frames_[index] = std::move(frame);
+        readyFrames_.store(index + 1, std::memory_order_release);
+        return true;
+    }
+
+
+    /**
+     * @brief Mark a progressive animation as fully loaded
+     * @details If the loader failed part way, playback ends at the last published frame.
+     */
+    void finishProgressive() {
+        loading_.store(false, std::memory_order_release);
+    }
+
+
+    /**
+     * @brief Get the number of frames that can be played right now
+     * @return All frames, or the frames published so far for a progressive animation
+     */
+    size_t readyFrameCount() const {
+        if (progressive_.load(std::memory_order_acquire)) return readyFrames_.load(std::memory_order_acquire);
+        return frameCount();
+    }
+
+
+    /**
+     * @brief Checks if a loader is still publishing frames
+     */
+    bool isLoading() const {
+        return loading_.load(std::memory_order_acquire);
+    }
+
+
+    /**
+     * @brief Publish the animation as immutable
+     * @param ledLimit Drop pixels at or beyond this LED index, e.g. the strip's length
+     * @details After this, the name, hash and frames are read without locking and
+     * every mutation is refused. Build or load the animation first, then freeze it
+     * before handing it to other tasks. Freezing also normalizes every frame, see
+     * normalizeFrame(), and measures its bounds.
+     */
+    void freeze(uint16_t ledLimit = UINT16_MAX) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        building_ = false;
+        if (frozen_.load(std::memory_order_relaxed)) return;
+
+        bounds_.resize(frames_.size());
+        for (size_t i = 0; i < frames_.size(); i++) {
+            normalizeFrame(frames_[i], ledLimit);
+            bounds_[i] = FrameBounds::of(frames_[i]);
+        }
+        frozen_.store(true, std::memory_order_release);
+    }
+
+
+    /**
+     * @brief Checks if the animation has been frozen
+     * @return True if the animation is immutable and read without locking
+     */
+    bool isFrozen() const {
+        return frozen_.load(std::memory_order_acquire);
+    }
+
 
     /**
      * @brief Get a deep copy of the frames in the animation
@@ -212,6 +565,7 @@ public:
      * @return A deep copy of the frame buffer
      */
     FrameBuffer getFramesDeepCopy() const {
+        if (readsAreLockFree()) return frames_;
         std::lock_guard<std::mutex> lock(mutex_);
         debugf("Deep copy requested for %zu frames\n", frames_.size());
         FrameBuffer copy = frames_;
@@ -221,20 +575,109 @@ public:
     /**
      * @brief Get a reference to the frames in the animation
      * @return A reference to the frame buffer
-     * @details This method is thread-safe and locks the mutex while accessing frames_
+     * @details Lock-free once the animation is frozen, otherwise locks the mutex while accessing frames_
      */
     const FrameBuffer& getFrames() const {
+        if (readsAreLockFree()) return frames_;
         std::lock_guard<std::mutex> lock(mutex_);
         return frames_;
     }
 
 
+    /**
+     * @brief Give every frame an absolute start time
+     * @param frameTimes The start of each frame in milliseconds, one per frame, never decreasing
+     * @param durationMs The end of the timeline, at least the last start time
+     * @return False if the times do not match the frames or the animation is frozen
+     * @details Call after the frames are added. A timeline replaces the fixed frame
+     * delay, so frames can be shown for different lengths of time.
+     */
+    bool setTimeline(std::vector<uint32_t>&& frameTimes, uint32_t durationMs) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (rejectIfFrozen("setTimeline")) return false;
+        if (frameTimes.size() != frames_.size() || !std::is_sorted(frameTimes.begin(), frameTimes.end())) {
+            debugf("Timeline of '%s' needs %zu increasing frame times, got %zu\n", name_.c_str(), frames_.size(), frameTimes.size());
+            return false;
+        }
+        durationMs_ = frameTimes.empty() ? durationMs : std::max(durationMs, frameTimes.back());
+        frameTimes_ = std::move(frameTimes);
+        return true;
+    }
+
+    /**
+     * @brief Checks if the frames carry their own start times
+     */
+    bool hasTimeline() const {
+        if (readsAreLockFree()) return !frameTimes_.empty();
+        std::lock_guard<std::mutex> lock(mutex_);
+        return !frameTimes_.empty();
+    }
+
+    /**
+     * @brief Get the end of the timeline in milliseconds
+     */
+    uint32_t timelineDurationMs() const {
+        if (readsAreLockFree()) return durationMs_;
+        std::lock_guard<std::mutex> lock(mutex_);
+        return durationMs_;
+    }
+
+    /**
+     * @brief Find the frame shown at a position on the timeline
+     * @param positionMs The position in milliseconds, below timelineDurationMs()
+     * @param cursor The frame found by the previous lookup, updated to the result
+     * @return The index of the last frame starting at or before the position
+     * @details O(1) while playback moves forward by at most one frame between
+     * lookups, a binary search otherwise. Only valid on a frozen animation with a timeline.
+     */
+    size_t frameAtMs(uint32_t positionMs, size_t& cursor) const {
+        const std::vector<uint32_t>& times = frameTimes_;
+        const size_t count = times.size();
+        if (count == 0) return 0;
+
+        for (size_t candidate = cursor; candidate < count && candidate <= cursor + 1; candidate++) {
+            if (times[candidate] <= positionMs && (candidate + 1 == count || positionMs < times[candidate + 1])) {
+                cursor = candidate;
+                return cursor;
+            }
+        }
+
+        const size_t after = std::upper_bound(times.begin(), times.end(), positionMs) - times.begin();
+        cursor = after == 0 ? 0 : after - 1;
+        return cursor;
+    }
+
+    /**
+     * @brief Get the time a frame is replaced by the next one
+     * @param index The frame index
+     * @return The start of the next frame, or the end of the timeline for the last frame
+     * @details Only valid on a frozen animation with a timeline.
+     */
+    uint32_t frameEndMs(size_t index) const {
+        return index + 1 < frameTimes_.size() ? frameTimes_[index + 1] : durationMs_;
+    }
+
+
+    /**
+     * @brief Get the range of LEDs a frame writes to
+     * @param index The frame index
+     * @return The bounds, empty for an index out of range or a frame not published yet
+     * @details Read from the table measured by freeze(), or measured on the spot before that.
+     */
+    FrameBounds getFrameBounds(size_t index) const {
+        if (readsAreLockFree()) return index < readyFrameCount() ? bounds_[index] : FrameBounds();
+        std::lock_guard<std::mutex> lock(mutex_);
+        return index < frames_.size() ? FrameBounds::of(frames_[index]) : FrameBounds();
+    }
+
+
     /**
      * @brief Clear the frames in the animation
      * @details Clears the frame buffer and resets the animation name to "NONE"
      */
     void clearFrames() {
         std::lock_guard<std::mutex> lock(mutex_);
+        if (rejectIfFrozen("clearFrames")) return;
         frames_.clear();
         name_ = "NONE";
         nameHash_ = hash_string_runtime("NONE");
@@ -243,12 +686,79 @@ public:
 };
 
 
+/**
+ * @brief Hand an animation over to other tasks
+ * @param animation The animation to move in
+ * @return A shared, frozen animation, read without locking
+ */
+inline std::shared_ptr<const Animation> shareAnimation(Animation&& animation) {
+    std::shared_ptr<Animation> shared = std::make_shared<Animation>(std::move(animation));
+    shared->freeze();
+    return shared;
+}
+
+
 /**
  * @brief Load an animation from a file in the specified file system.
  * @param fs The file system to read from.
+ * @param path The path to the animation file, JSON or a .anim file from the host optimizer.
+ * @param ledLimit Drop pixels at or beyond this LED index, the strip length if it is known.
+ * @return An Animation object loaded from the file, or an empty Animation if loading failed.
+ * @details JSON is read one frame at a time through the sidecar frame index, see
+ * frameindex.h, or through one built by a scan. The whole document is never parsed at once.
+ */
+Animation loadAnimation(fs::FS& fs, const std::string& path, uint16_t ledLimit = UINT16_MAX);
+
+
+/**
+ * @brief Load an animation written by the host optimizer (tools/animopt).
+ * @param fs The file system to read from.
+ * @param path The path to the .anim file.
+ * @param ledLimit Drop pixels at or beyond this LED index, the strip length if it is known.
+ * @return An Animation object loaded from the file, or an empty Animation if loading failed.
+ * @details Decodes palette, spans, mirrored rows and LZ compression back into sparse
+ * frames. loadAnimation() calls this for paths ending in .anim.
+ */
+Animation loadAnimationBinary(fs::FS& fs, const std::string& path, uint16_t ledLimit = UINT16_MAX);
+
+
+/**
+ * @brief Convert the JSON text of one frame into pixels.
+ * @param frame The frame to fill.
+ * @param json The frame, an array of [index, r, g, b] arrays.
+ * @param doc A document reused across frames.
+ * @return True if the frame was valid.
+ */
+bool parseFrameJson(Frame& frame, const std::string& json, JsonDocument& doc);
+
+
+/**
+ * @brief Load an animation with the work split across both cores.
+ * @param fs The file system to read from.
  * @param path The path to the animation file.
+ * @param ledLimit Drop pixels at or beyond this LED index, the strip length if it is known.
  * @return An Animation object loaded from the file, or an empty Animation if loading failed.
+ * @details The calling task reads the file and cuts out each frame's JSON text. A task
+ * on the other core converts the pixels and builds the frames. The two stages are
+ * connected by a bounded lock-free queue, and the file is never held in memory whole.
+ * Uses the calling task's notification value while it runs.
+ */
+Animation loadAnimationPipelined(fs::FS& fs, const std::string& path, uint16_t ledLimit = UINT16_MAX);
+
+
+/**
+ * @brief Start loading an animation and return as soon as its first frame is ready.
+ * @param fs The file system to read from.
+ * @param path The path to the animation file.
+ * @param ledLimit Drop pixels at or beyond this LED index, the strip length if it is known.
+ * @return The animation, still filling in, or nullptr if loading failed before the first frame.
+ * @details Runs the pipelined loader in background tasks. The metadata must come before
+ * the frames in the file so the frame table can be sized up front. Pass the result to
+ * Renderer::setAnimation() right away; playback holds the current frame whenever it
+ * catches up with the loader. Per-frame timestamps are ignored, the animation plays at
+ * the fixed frame delay. The loader notifies the calling task at most once and never
+ * after this returns.
  */
-Animation loadAnimation(fs::FS& fs, const std::string& path);
+std::shared_ptr<const Animation> loadAnimationProgressive(fs::FS& fs, const std::string& path, uint16_t ledLimit = UINT16_MAX);
 
 #endif
\ No newline at end of file
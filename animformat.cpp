@@ -0,0 +1,169 @@
+#include "animation.h"
+#include "animformat.h"
+#include "budget.h"
+
+/**
+ * @brief Bounds-checked little-endian reader over a decoded payload
+ * @details Reads past the end return 0 and clear ok, so a truncated file is caught
+ * once after a whole section instead of at every field.
+ */
+struct PayloadReader {
+    const uint8_t* data;
+    size_t size;
+    size_t pos = 0;
+    bool ok = true;
+
+    PayloadReader(const uint8_t* data, size_t size) : data(data), size(size) {}
+
+    uint8_t u8() {
+        if (size - pos < 1) { ok = false; return 0; }
+        return data[pos++];
+    }
+
+    uint16_t u16() {
+        if (size - pos < 2) { ok = false; pos = size; return 0; }
+        const uint16_t value = data[pos] | (data[pos + 1] << 8);
+        pos += 2;
+        return value;
+    }
+
+    uint32_t u32() {
+        const uint32_t low = u16();
+        return low | (static_cast<uint32_t>(u16()) << 16);
+    }
+};
+
+
+Animation loadAnimationBinary(fs::FS& fs, const std::string& path, uint16_t ledLimit) {
+    File file = fs.open(path.c_str(), FILE_READ);
+    if (!file || file.isDirectory()) {
+        debugf("Failed to open animation file: %s\n", path.c_str());
+        return Animation();
+    }
+
+    AnimFileHeader header;
+    if (file.read(reinterpret_cast<uint8_t*>(&header), sizeof(header)) != sizeof(header) ||
+        header.magic != ANIM_MAGIC || header.version != ANIM_VERSION) {
+        debugf("%s is not a version %d animation file\n", path.c_str(), ANIM_VERSION);
+        file.close();
+        return Animation();
+    }
+
+    std::string name(header.nameLength, '\0');
+    if (file.read(reinterpret_cast<uint8_t*>(&name[0]), header.nameLength) != header.nameLength) {
+        debugf("%s is truncated\n", path.c_str());
+        file.close();
+        return Animation();
+    }
+
+    // Refuse before allocating if the payload buffers cannot fit
+    const bool compressed = header.flags & ANIM_FLAG_LZ;
+    const size_t bufferBytes = header.storedBytes + (compressed ? header.payloadBytes : 0);
+    if (!heapFits(bufferBytes)) {
+        debugf("Animation '%s' needs %zu bytes to decode, more than the free heap\n", name.c_str(), bufferBytes);
+        file.close();
+        return Animation();
+    }
+
+    std::vector<uint8_t> stored(header.storedBytes);
+    const bool complete = file.read(stored.data(), stored.size()) == stored.size();
+    file.close();
+    if (!complete) {
+        debugf("%s is truncated\n", path.c_str());
+        return Animation();
+    }
+
+    std::vector<uint8_t> payload;
+    if (compressed) {
+        payload.resize(header.payloadBytes);
+        if (!animLzDecompress(stored.data(), stored.size(), payload.data(), payload.size())) {
+            debugf("%s is corrupt\n", path.c_str());
+            return Animation();
+        }
+        std::vector<uint8_t>().swap(stored);
+    } else {
+        payload = std::move(stored);
+    }
+
+    PayloadReader in(payload.data(), payload.size());
+
+    std::vector<uint8_t> palette;
+    if (header.flags & ANIM_FLAG_PALETTE) {
+        palette.resize(static_cast<size_t>(in.u16()) * 3);
+        for (uint8_t& channel : palette) channel = in.u8();
+    }
+
+    std::vector<uint16_t> table(header.frameCount);
+    for (uint16_t& id : table) {
+        id = in.u16();
+        if (id >= header.uniqueFrames) in.ok = false;
+    }
+
+    std::vector<uint32_t> frameTimes;
+    uint32_t durationMs = 0;
+    if (header.flags & ANIM_FLAG_TIMELINE) {
+        frameTimes.resize(header.frameCount);
+        for (uint32_t& time : frameTimes) time = in.u32();
+        durationMs = in.u32();
+    }
+
+    const bool mirror = (header.flags & ANIM_FLAG_MIRROR) && header.width > 0;
+    if (!in.ok) {
+        debugf("%s is truncated\n", path.c_str());
+        return Animation();
+    }
+
+    // Expand the spans of every distinct frame into sparse pixels
+    FrameBuffer unique(header.uniqueFrames);
+    for (Frame& frame : unique) {
+        const uint16_t spans = in.u16();
+        for (uint16_t s = 0; s < spans && in.ok; s++) {
+            const uint16_t first = in.u16();
+            const uint8_t length = in.u8();
+            uint8_t r, g, b;
+            if (palette.empty()) {
+                r = in.u8();
+                g = in.u8();
+                b = in.u8();
+            } else {
+                const size_t color = static_cast<size_t>(in.u8()) * 3;
+                if (color >= palette.size()) {
+                    in.ok = false;
+                    break;
+                }
+                r = palette[color];
+                g = palette[color + 1];
+                b = palette[color + 2];
+            }
+
+            for (uint16_t i = 0; i < length; i++) {
+                const uint16_t index = first + i;
+                frame.emplace_back(index, r, g, b);
+                if (!mirror) continue;
+                const uint16_t x = index % header.width;
+                const uint16_t mirrored = header.width - 1 - x;
+                if (mirrored != x) frame.emplace_back(index - x + mirrored, r, g, b);
+            }
+        }
+        if (!in.ok) break;
+
+        // Mirrored rows interleave both halves, sort once here rather than per copy
+        normalizeFrame(frame, ledLimit);
+    }
+
+    if (!in.ok) {
+        debugf("%s is truncated or corrupt\n", path.c_str());
+        return Animation();
+    }
+    std::vector<uint8_t>().swap(payload);
+
+    Animation animation(name);
+    animation.reserveFrames(table.size());
+    // Every frame gets its own copy, deduplication only shrinks the file and its read time
+    for (uint16_t id : table) animation.appendFrame(Frame(unique[id]));
+    if (!frameTimes.empty() && !animation.setTimeline(std::move(frameTimes), durationMs)) return Animation();
+
+    animation.freeze(ledLimit);
+    debugf("Loaded animation '%s' with %zu frames (%d distinct) from %s\n", name.c_str(), table.size(), header.uniqueFrames, path.c_str());
+    return animation;
+}
@@ -0,0 +1,105 @@
+#pragma once
+#ifndef ANIMFORMAT_H
+#define ANIMFORMAT_H
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+/**
+ * @brief Binary animation format written by the host optimizer in tools/animopt
+ * @details Little-endian. An AnimFileHeader, the name, then the payload, stored LZ
+ * compressed when ANIM_FLAG_LZ is set. The payload holds, in order:
+ *  - with ANIM_FLAG_PALETTE: u16 color count, then r, g, b per color
+ *  - the frame table: u16 unique frame id per frame, so repeated frames are stored once
+ *    in the file. The loader still gives every frame its own copy in RAM.
+ *  - with ANIM_FLAG_TIMELINE: u32 start time per frame, then the u32 duration
+ *  - the unique frames: u16 span count, then per span u16 first LED, u8 length and
+ *    the color, a u8 palette index with ANIM_FLAG_PALETTE or r, g, b otherwise
+ * With ANIM_FLAG_MIRROR, the spans only cover the left half of each row of width LEDs
+ * and the decoder mirrors them onto the right half.
+ * This header is shared with the host tool, keep it free of Arduino dependencies.
+ */
+#define ANIM_MAGIC 0x4D4E4145      // "EANM"
+#define ANIM_VERSION 1
+#define ANIM_FILE_SUFFIX ".anim"
+
+enum AnimFlags : uint16_t {
+    ANIM_FLAG_PALETTE = 1 << 0,     // Colors are indices into a palette of up to 256 colors
+    ANIM_FLAG_MIRROR = 1 << 1,      // Rows are stored half and mirrored
+    ANIM_FLAG_LZ = 1 << 2,          // Payload is LZ compressed
+    ANIM_FLAG_TIMELINE = 1 << 3     // Frames carry start times
+};
+
+struct __attribute__((packed)) AnimFileHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t flags;                 // AnimFlags
+    uint16_t frameCount;            // Frames in playback order
+    uint16_t uniqueFrames;          // Distinct frames stored in the payload
+    uint16_t totalPixels;           // LEDs the animation was made for
+    uint16_t width;                 // Row length used by ANIM_FLAG_MIRROR
+    uint16_t reserved[2];           // Written as 0, the frame and repeat delays come from the renderer as for JSON
+    uint32_t payloadBytes;          // Payload size once decompressed
+    uint32_t storedBytes;           // Payload size in the file
+    uint8_t nameLength;             // Bytes of the name following the header
+};
+
+
+/**
+ * @brief Read an extended LZ length: 15 in the token means more bytes follow
+ */
+inline bool animLzLength(const uint8_t* in, size_t inSize, size_t& ip, size_t& length) {
+    if (length != 15) return true;
+    uint8_t more;
+    do {
+        if (ip >= inSize) return false;
+        more = in[ip++];
+        length += more;
+    } while (more == 255);
+    return true;
+}
+
+/**
+ * @brief Decompress an LZ payload
+ * @param in The compressed bytes
+ * @param inSize The number of compressed bytes
+ * @param out The buffer to fill, outSize bytes
+ * @param outSize The decompressed size recorded in the header
+ * @return False if the stream is corrupt or does not decompress to outSize bytes
+ * @details Sequences of a token byte (literal count in the high nibble, match length
+ * minus 4 in the low nibble), the literals and a u16 match offset. The stream may end
+ * right after the literals of its last sequence.
+ */
+inline bool animLzDecompress(const uint8_t* in, size_t inSize, uint8_t* out, size_t outSize) {
+    size_t ip = 0;
+    size_t op = 0;
+
+    while (ip < inSize) {
+        const uint8_t token = in[ip++];
+
+        size_t literals = token >> 4;
+        if (!animLzLength(in, inSize, ip, literals)) return false;
+        if (literals > inSize - ip || literals > outSize - op) return false;
+        memcpy(out + op, in + ip, literals);
+        ip += literals;
+        op += literals;
+        if (ip >= inSize) break;
+
+        if (inSize - ip < 2) return false;
+        const size_t offset = in[ip] | (in[ip + 1] << 8);
+        ip += 2;
+
+        size_t length = token & 0x0F;
+        if (!animLzLength(in, inSize, ip, length)) return false;
+        length += 4;
+        if (offset == 0 || offset > op || length > outSize - op) return false;
+
+        // Byte by byte, a match may overlap the bytes it produces
+        for (size_t i = 0; i < length; i++, op++) out[op] = out[op - offset];
+    }
+
+    return op == outSize;
+}
+
+#endif
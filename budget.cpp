@@ -0,0 +1,165 @@
+#include "budget.h"
+
+/**
+ * @brief Read buffer a streamed animation keeps open on the file system
+ */
+static constexpr size_t STREAM_BUFFER_BYTES = 2048;
+
+
+const char* representationName(Representation rep) {
+    switch (rep) {
+        case Representation::Sparse:   return "sparse";
+        case Representation::Dense:    return "dense";
+        case Representation::Palette:  return "palette";
+        case Representation::Delta:    return "delta";
+        case Representation::Streamed: return "streamed";
+        default:                       return "unknown";
+    }
+}
+
+
+/**
+ * @brief Checks if the renderer can play a representation directly
+ * @details Frames are played as sparse pixel lists. The other representations
+ * are planned so callers can see what they would cost.
+ */
+static bool isPlayable(Representation rep) {
+    return rep == Representation::Sparse;
+}
+
+
+size_t sparseBytes(size_t frameCount, size_t pixelEntries) {
+    return 2 * HEAP_BLOCK_OVERHEAD + frameCount * (sizeof(Frame) + sizeof(FrameBounds))
+         + frameCount * HEAP_BLOCK_OVERHEAD + pixelEntries * sizeof(Pixel);
+}
+
+
+size_t outputBufferBytes(uint16_t ledCount) {
+    return HEAP_BLOCK_OVERHEAD + static_cast<size_t>(ledCount) * 3;
+}
+
+
+AnimationStats measureFrames(const FrameBuffer& frames, uint16_t ledCount) {
+    AnimationStats stats;
+    stats.frames = frames.size();
+
+    std::vector<uint32_t> strip(ledCount, 0);
+    std::vector<uint32_t> colors;
+    colors.reserve(257);
+
+    for (const Frame& frame : frames) {
+        stats.pixelEntries += frame.size();
+        stats.maxFrameEntries = std::max(stats.maxFrameEntries, frame.size());
+
+        for (const Pixel& pixel : frame) {
+            const uint32_t color = (static_cast<uint32_t>(pixel.r) << 16) | (pixel.g << 8) | pixel.b;
+
+            if (colors.size() < 257) {
+                auto it = std::lower_bound(colors.begin(), colors.end(), color);
+                if (it == colors.end() || *it != color) colors.insert(it, color);
+            }
+
+            if (pixel.index < ledCount && strip[pixel.index] != color) {
+                strip[pixel.index] = color;
+                stats.deltaEntries++;
+            }
+        }
+    }
+
+    stats.uniqueColors = colors.size();
+    return stats;
+}
+
+
+AnimationStats measurePlayable(const FrameBuffer& frames, uint16_t ledCount) {
+    for (size_t i = 0; i < static_cast<size_t>(Representation::Count); i++) {
+        const Representation rep = static_cast<Representation>(i);
+        if (rep != Representation::Sparse && isPlayable(rep)) return measureFrames(frames, ledCount);
+    }
+
+    AnimationStats stats;
+    stats.frames = frames.size();
+    for (const Frame& frame : frames) {
+        stats.pixelEntries += frame.size();
+        stats.maxFrameEntries = std::max(stats.maxFrameEntries, frame.size());
+    }
+    stats.uniqueColors = 257;
+    stats.deltaEntries = stats.pixelEntries;
+    return stats;
+}
+
+
+/**
+ * @brief Capabilities of the internal heap and of PSRAM, the heaps malloc picks from
+ */
+static constexpr uint32_t INTERNAL_CAPS = MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT;
+static constexpr uint32_t PSRAM_CAPS = MALLOC_CAP_SPIRAM;
+
+
+/**
+ * @brief Checks if data fits one heap
+ * @param freeBytes The free size of the heap
+ * @param reserve Bytes of the heap to leave untouched
+ */
+static bool fitsHeap(size_t bytes, size_t freeBytes, size_t releasedBytes, size_t reserve) {
+    const size_t available = freeBytes + releasedBytes;
+    return available > reserve && bytes <= available - reserve;
+}
+
+
+bool heapFits(size_t bytes, size_t releasedBytes) {
+    return fitsHeap(bytes, heap_caps_get_free_size(INTERNAL_CAPS), releasedBytes, HEAP_RESERVE_BYTES)
+        || fitsHeap(bytes, heap_caps_get_free_size(PSRAM_CAPS), releasedBytes, 0);
+}
+
+
+MemoryPlan planAnimationMemory(const AnimationStats& stats, uint16_t ledCount, size_t releasedBytes) {
+    MemoryPlan plan;
+    plan.freeInternal = heap_caps_get_free_size(INTERNAL_CAPS);
+    plan.freePsram = heap_caps_get_free_size(PSRAM_CAPS);
+
+    const size_t denseFrame = static_cast<size_t>(ledCount) * 3;
+    const size_t paletteIndex = stats.uniqueColors <= 256 ? 1 : 2;
+    const size_t paletteColors = stats.uniqueColors <= 256 ? stats.uniqueColors : std::min<size_t>(stats.pixelEntries, 65536);
+
+    plan.bytes[static_cast<size_t>(Representation::Sparse)] = sparseBytes(stats.frames, stats.pixelEntries);
+    plan.bytes[static_cast<size_t>(Representation::Dense)] = HEAP_BLOCK_OVERHEAD + stats.frames * denseFrame;
+    plan.bytes[static_cast<size_t>(Representation::Palette)] = 2 * HEAP_BLOCK_OVERHEAD + paletteColors * 3
+                                                              + stats.frames * ledCount * paletteIndex;
+    plan.bytes[static_cast<size_t>(Representation::Delta)] = sparseBytes(stats.frames, stats.deltaEntries);
+    plan.bytes[static_cast<size_t>(Representation::Streamed)] = 3 * HEAP_BLOCK_OVERHEAD + STREAM_BUFFER_BYTES
+                                                               + stats.maxFrameEntries * sizeof(Pixel)
+                                                               + stats.frames * sizeof(uint32_t);
+
+    // Largest single block, the frame table or the largest frame, checked in the same heap as the rest
+    const size_t largestAllocation = std::max(stats.frames * sizeof(Frame), stats.maxFrameEntries * sizeof(Pixel));
+    const bool blockFitsInternal = largestAllocation <= heap_caps_get_largest_free_block(INTERNAL_CAPS);
+    const bool blockFitsPsram = largestAllocation <= heap_caps_get_largest_free_block(PSRAM_CAPS);
+
+    size_t best = SIZE_MAX;
+    for (size_t i = 0; i < static_cast<size_t>(Representation::Count); i++) {
+        const Representation rep = static_cast<Representation>(i);
+        if (!isPlayable(rep) || plan.bytes[i] >= best) continue;
+        const bool internal = blockFitsInternal && fitsHeap(plan.bytes[i], plan.freeInternal, releasedBytes, HEAP_RESERVE_BYTES);
+        const bool psram = blockFitsPsram && fitsHeap(plan.bytes[i], plan.freePsram, releasedBytes, 0);
+        if (!internal && !psram) continue;
+        best = plan.bytes[i];
+        plan.chosen = rep;
+        plan.fits = true;
+        plan.needsPsram = !internal;
+    }
+    return plan;
+}
+
+
+void printMemoryPlan(const MemoryPlan& plan) {
+    debugf("Free heap: %zu internal, %zu PSRAM\n", plan.freeInternal, plan.freePsram);
+    for (size_t i = 0; i < static_cast<size_t>(Representation::Count); i++) {
+        debugf("  %-8s %zu bytes%s\n",
+            representationName(static_cast<Representation>(i)),
+            plan.bytes[i],
+            plan.fits && static_cast<size_t>(plan.chosen) == i ? " (chosen)" : ""
+        );
+    }
+    if (!plan.fits) debugln("  No playable representation fits the free heap");
+}
@@ -0,0 +1,128 @@
+#pragma once
+#ifndef BUDGET_H
+#define BUDGET_H
+
+#include "animation.h"
+#include <esp_heap_caps.h>
+
+
+/**
+ * @brief The ways an animation can be held in memory
+ */
+enum class Representation : uint8_t {
+    Sparse,     // Per-frame lists of Pixel entries, as loaded from JSON
+    Dense,      // Full RGB buffer for every LED of every frame
+    Palette,    // Full buffer of palette indices per frame plus a color table
+    Delta,      // Only the entries that change the strip compared to the previous frame
+    Streamed,   // One frame resident at a time, read from the file system
+    Count
+};
+
+
+/**
+ * @brief Get a printable name for a representation
+ */
+const char* representationName(Representation rep);
+
+
+/**
+ * @brief Content statistics the footprint of every representation derives from
+ */
+struct AnimationStats {
+    size_t frames = 0;          // Number of frames
+    size_t pixelEntries = 0;    // Pixel entries over all frames
+    size_t maxFrameEntries = 0; // Pixel entries in the largest frame
+    size_t uniqueColors = 0;    // Distinct colors, saturating at 257
+    size_t deltaEntries = 0;    // Entries that actually change the strip
+};
+
+
+/**
+ * @brief The footprint of each representation and the one chosen for playback
+ */
+struct MemoryPlan {
+    size_t bytes[static_cast<size_t>(Representation::Count)] = {0}; // Footprint of every representation, playable or not
+    Representation chosen = Representation::Sparse;
+    bool fits = false;          // The chosen representation fits internal RAM or PSRAM
+    bool needsPsram = false;    // The chosen representation only fits PSRAM
+    size_t freeInternal = 0;    // Free internal heap at planning time
+    size_t freePsram = 0;       // Free PSRAM heap at planning time
+
+    size_t bytesFor(Representation rep) const {
+        return bytes[static_cast<size_t>(rep)];
+    }
+};
+
+
+/**
+ * @brief Internal heap kept free for the system, Wi-Fi and the file system
+ */
+constexpr size_t HEAP_RESERVE_BYTES = 16 * 1024;
+
+/**
+ * @brief Bookkeeping the heap adds to every allocation
+ */
+constexpr size_t HEAP_BLOCK_OVERHEAD = 8;
+
+
+/**
+ * @brief Bytes the sparse representation takes for the given content
+ * @param frameCount The number of frames
+ * @param pixelEntries The pixel entries over all frames
+ */
+size_t sparseBytes(size_t frameCount, size_t pixelEntries);
+
+
+/**
+ * @brief Bytes the output buffer of a strip takes
+ * @param ledCount The number of LEDs
+ */
+size_t outputBufferBytes(uint16_t ledCount);
+
+
+/**
+ * @brief Gather the statistics the planner needs from a frame buffer
+ * @param frames The frames to measure
+ * @param ledCount The length of the strip the frames are played on
+ */
+AnimationStats measureFrames(const FrameBuffer& frames, uint16_t ledCount);
+
+
+/**
+ * @brief Gather only the statistics the playable representations need
+ * @param frames The frames to measure
+ * @param ledCount The length of the strip the frames are played on
+ * @details While sparse is the only playable representation, this counts frames and
+ * pixel entries without allocating and takes the color and delta counts at their
+ * upper bounds. Otherwise it is measureFrames().
+ */
+AnimationStats measurePlayable(const FrameBuffer& frames, uint16_t ledCount);
+
+
+/**
+ * @brief Compute the footprint of every representation and pick the one to hold
+ * @param stats The content statistics
+ * @param ledCount The length of the strip the animation is played on
+ * @param releasedBytes Bytes that will be freed when the new data is committed
+ * @return The plan. Only representations the renderer can play are chosen.
+ */
+MemoryPlan planAnimationMemory(const AnimationStats& stats, uint16_t ledCount, size_t releasedBytes = 0);
+
+
+/**
+ * @brief Print the footprint of every representation
+ */
+void printMemoryPlan(const MemoryPlan& plan);
+
+
+/**
+ * @brief Checks if data fits the free internal heap or the free PSRAM heap on its own
+ * @param bytes The size of the data
+ * @param releasedBytes Bytes that will be freed in exchange, from the same heap
+ * @details An allocation comes from one heap, so the two are never added up. The
+ * check is conservative for data made of many blocks, which malloc may spread over
+ * both. Internal RAM keeps HEAP_RESERVE_BYTES free.
+ */
+bool heapFits(size_t bytes, size_t releasedBytes = 0);
+
+#endif
@@ -0,0 +1,133 @@
+#include "clock.h"
+
+/**
+ * @brief Fold a reference time sample into the clock
+ * @param referenceMs The external reference time in milliseconds
+ * @details The phase error is slewed in over the following frames and a fraction
+ * of it is kept as a frequency correction, so a steady drift between the local
+ * timer and the reference is tracked without repeated corrections.
+ */
+void PlaybackClock::discipline(uint32_t referenceMs) {
+    const int64_t now = advance();
+    const int64_t reference = static_cast<int64_t>(referenceMs) * 1000;
+    const int64_t error = reference - (now + pendingUs_);
+
+    if (!locked_ || error > stepThresholdUs || error < -stepThresholdUs) {
+        debugf("Clock stepped to %lu ms (error %lld us)\n", (unsigned long)referenceMs, (long long)error);
+        anchorClockUs_ = reference;
+        pendingUs_ = 0;
+        lastSampleLocalUs_ = anchorLocalUs_;
+        locked_ = true;
+        return;
+    }
+
+    const int64_t interval = anchorLocalUs_ - lastSampleLocalUs_;
+    lastSampleLocalUs_ = anchorLocalUs_;
+    pendingUs_ += error;
+
+    if (interval > 0) {
+        ratePpm_ += error * 1000000 / interval / 8;
+        ratePpm_ = std::clamp(ratePpm_, -maxRatePpm, maxRatePpm);
+    }
+}
+
+
+bool SerialTimecode::poll(uint32_t& referenceMs) {
+    bool received = false;
+
+    while (stream_.available() > 0) {
+        const int c = stream_.read();
+        if (c < 0) break;
+
+        if (c != '\n' && c != '\r') {
+            if (length_ < sizeof(line_) - 1) line_[length_++] = static_cast<char>(c);
+            else length_ = sizeof(line_);   // Overlong line, drop it at the terminator
+            continue;
+        }
+
+        if (length_ > 1 && length_ < sizeof(line_) && line_[0] == 'T') {
+            line_[length_] = '\0';
+            char* end = nullptr;
+            const unsigned long value = strtoul(line_ + 1, &end, 10);
+            if (end != nullptr && *end == '\0') {
+                referenceMs = static_cast<uint32_t>(value);
+                received = true;
+            }
+        }
+        length_ = 0;
+    }
+
+    return received;
+}
+
+
+uint32_t MidiTimecode::toMs(uint8_t rateBits, uint8_t hours, uint8_t minutes, uint8_t seconds, uint8_t frames) {
+    static const uint16_t framesPerSecond[4] = {24, 25, 30, 30};
+    const uint32_t wholeSeconds = (static_cast<uint32_t>(hours) * 60 + minutes) * 60 + seconds;
+    uint32_t frameMs = static_cast<uint32_t>(frames) * 1000 / framesPerSecond[rateBits & 0x03];
+    if ((rateBits & 0x03) == 2) frameMs = static_cast<uint32_t>(frames) * 1001 / 30;   // 29.97 fps drop-frame
+    return wholeSeconds * 1000 + frameMs;
+}
+
+
+bool MidiTimecode::poll(uint32_t& referenceMs) {
+    bool received = false;
+
+    while (stream_.available() > 0) {
+        const int c = stream_.read();
+        if (c < 0) break;
+        const uint8_t byte = static_cast<uint8_t>(c);
+
+        // Real-time messages may appear anywhere, even inside SysEx
+        if (byte >= 0xF8) continue;
+
+        if (byte & 0x80) {
+            expectQuarterFrame_ = byte == 0xF1;
+            if (byte == 0xF0) {
+                inSysex_ = true;
+                sysexLength_ = 0;
+            }
+
+            if (byte == 0xF7 && inSysex_) {
+                inSysex_ = false;
+                // F0 7F <device> 01 01 hh mm ss ff F7, with F0 and F7 not buffered
+                if (sysexLength_ == 8 && sysex_[0] == 0x7F && sysex_[2] == 0x01 && sysex_[3] == 0x01) {
+                    referenceMs = toMs(sysex_[4] >> 5, sysex_[4] & 0x1F, sysex_[5], sysex_[6], sysex_[7]);
+                    receivedPieces_ = 0;
+                    received = true;
+                }
+            } else if (byte != 0xF0) {
+                inSysex_ = false;
+            }
+            continue;
+        }
+
+        if (inSysex_) {
+            if (sysexLength_ < sizeof(sysex_)) sysex_[sysexLength_++] = byte;
+            continue;
+        }
+
+        if (!expectQuarterFrame_) continue;
+        expectQuarterFrame_ = false;
+
+        const uint8_t piece = (byte >> 4) & 0x07;
+        if (piece == 0) receivedPieces_ = 0;
+        pieces_[piece] = byte & 0x0F;
+        receivedPieces_ |= 1 << piece;
+
+        if (piece == 7 && receivedPieces_ == 0xFF) {
+            const uint8_t rateBits = (pieces_[7] >> 1) & 0x03;
+            const uint8_t frames = pieces_[0] | (pieces_[1] << 4);
+            const uint8_t seconds = pieces_[2] | (pieces_[3] << 4);
+            const uint8_t minutes = pieces_[4] | (pieces_[5] << 4);
+            const uint8_t hours = pieces_[6] | ((pieces_[7] & 0x01) << 4);
+
+            // A full quarter-frame sequence spans two frames, so the encoded time is two frames old
+            referenceMs = toMs(rateBits, hours, minutes, seconds, frames) + toMs(rateBits, 0, 0, 0, 2);
+            receivedPieces_ = 0;
+            received = true;
+        }
+    }
+
+    return received;
+}
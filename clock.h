@@ -0,0 +1,152 @@
+#pragma once
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include "io.h"
+#include <Arduino.h>
+#include <esp_timer.h>
+#include <cstdint>
+
+
+/**
+ * @brief Animation clock that can be phase-locked to an external reference
+ * @details Free-runs on the local microsecond timer. Each reference sample from
+ * discipline() is folded in by slewing the clock rate instead of stepping it, so
+ * playback never jumps visibly. Only the first sample, or one that is further off
+ * than stepThresholdMs, sets the clock directly.
+ */
+struct PlaybackClock {
+private:
+    static constexpr int64_t maxSlewPpm = 50000;        // Clock may run at most 5% fast or slow while correcting
+    static constexpr int64_t maxRatePpm = 2000;         // Bound of the learned frequency error
+    static constexpr int64_t stepThresholdUs = 1000000; // Errors above this step the clock instead of slewing
+
+    int64_t anchorLocalUs_ = 0;     // Local timer value at the last update
+    int64_t anchorClockUs_ = 0;     // Clock value at the last update
+    int64_t pendingUs_ = 0;         // Phase correction not yet slewed in
+    int64_t ratePpm_ = 0;           // Learned frequency correction in parts per million
+    int64_t lastSampleLocalUs_ = 0; // Local timer value of the last reference sample
+    bool locked_ = false;           // Set once the first reference sample arrived
+
+    /**
+     * @brief Advance the clock to the current local time
+     * @return The clock value in microseconds
+     */
+    int64_t advance() {
+        const int64_t local = esp_timer_get_time();
+        const int64_t dt = local - anchorLocalUs_;
+        int64_t step = dt + dt * ratePpm_ / 1000000;
+
+        const int64_t maxSlew = dt * maxSlewPpm / 1000000;
+        const int64_t slew = std::clamp(pendingUs_, -maxSlew, maxSlew);
+        pendingUs_ -= slew;
+        step += slew;
+
+        anchorLocalUs_ = local;
+        anchorClockUs_ += step;
+        return anchorClockUs_;
+    }
+
+public:
+    PlaybackClock() {
+        reset(0);
+    }
+
+    /**
+     * @brief Restart the clock at the given time and forget the reference
+     * @param ms The clock value to restart at
+     */
+    void reset(uint32_t ms) {
+        anchorLocalUs_ = esp_timer_get_time();
+        anchorClockUs_ = static_cast<int64_t>(ms) * 1000;
+        lastSampleLocalUs_ = anchorLocalUs_;
+        pendingUs_ = 0;
+        ratePpm_ = 0;
+        locked_ = false;
+    }
+
+    /**
+     * @brief Get the current clock time
+     * @return The clock time in milliseconds
+     */
+    uint32_t nowMs() {
+        return static_cast<uint32_t>(advance() / 1000);
+    }
+
+    /**
+     * @brief Fold a reference time sample into the clock
+     * @param referenceMs The external reference time in milliseconds
+     */
+    void discipline(uint32_t referenceMs);
+
+    /**
+     * @brief Checks if the clock follows an external reference
+     * @return True once a reference sample was received
+     */
+    bool isLocked() const {
+        return locked_;
+    }
+};
+
+
+/**
+ * @brief A source of external reference time, polled from the render task
+ */
+struct TimecodeSource {
+    virtual ~TimecodeSource() = default;
+
+    /**
+     * @brief Read any pending timecode data
+     * @param referenceMs Set to the latest reference time if one was completed
+     * @return True if a new reference time was completed
+     */
+    virtual bool poll(uint32_t& referenceMs) = 0;
+};
+
+
+/**
+ * @brief Plain text time sync messages over a Stream
+ * @details Reads lines of the form "T<milliseconds>\n". Any Stream works: a UART,
+ * the USB serial port, or a File / pipe standing in for the host.
+ */
+struct SerialTimecode : TimecodeSource {
+private:
+    Stream& stream_;
+    char line_[16];
+    size_t length_ = 0;
+
+public:
+    explicit SerialTimecode(Stream& stream) : stream_(stream) {}
+
+    bool poll(uint32_t& referenceMs) override;
+};
+
+
+/**
+ * @brief MIDI timecode over a Stream
+ * @details Understands quarter-frame messages (0xF1) and full-frame SysEx messages
+ * (F0 7F 7F 01 01 hh mm ss ff F7). Other MIDI traffic is ignored.
+ */
+struct MidiTimecode : TimecodeSource {
+private:
+    Stream& stream_;
+    uint8_t pieces_[8] = {0};   // Nibbles of the quarter-frame sequence
+    uint8_t receivedPieces_ = 0;// Bitmask of quarter-frame pieces seen since piece 0
+    uint8_t sysex_[10] = {0};   // Buffer for a full-frame message
+    uint8_t sysexLength_ = 0;
+    bool inSysex_ = false;
+    bool expectQuarterFrame_ = false;
+
+    /**
+     * @brief Convert SMPTE time to milliseconds
+     * @param rateBits The two rate bits from the hours field (24, 25, 29.97 drop, 30 fps)
+     */
+    static uint32_t toMs(uint8_t rateBits, uint8_t hours, uint8_t minutes, uint8_t seconds, uint8_t frames);
+
+public:
+    explicit MidiTimecode(Stream& stream) : stream_(stream) {}
+
+    bool poll(uint32_t& referenceMs) override;
+};
+
+#endif
@@ -0,0 +1,115 @@
+#include "corehelper.h"
+#include "heapguard.h"
+
+
+void CoreHelper::helperTask(void* parameters) {
+    CoreHelper* helper = static_cast<CoreHelper*>(parameters);
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        // Take the caller's priority once for the whole job, so only tasks the caller would
+        // yield to as well can preempt the helper while the caller waits on its chunk
+        const UBaseType_t boost = helper->boost_.load(std::memory_order_relaxed);
+        if (boost != CORE_HELPER_PRIORITY) vTaskPrioritySet(nullptr, boost);
+
+        size_t done = 0;
+        while (helper->helpOnce()) done++;
+        if (done > 0) helper->helped_.fetch_add(done, std::memory_order_relaxed);
+
+        // Back to just above idle until the next job
+        if (boost != CORE_HELPER_PRIORITY) vTaskPrioritySet(nullptr, CORE_HELPER_PRIORITY);
+    }
+}
+
+
+bool CoreHelper::helpOnce() {
+    inFlight_.fetch_add(1);
+
+    const uint32_t claim = claim_.fetch_add(1);
+    const uint32_t chunk = claim & 0xFFFF;
+    const bool claimed = chunk < (claim >> 16);
+    if (claimed) fn_(context_, chunk);
+
+    if (inFlight_.fetch_sub(1) == 1 && waiting_.exchange(false)) xSemaphoreGive(idle_);
+    return claimed;
+}
+
+
+size_t CoreHelper::drain() {
+    size_t done = 0;
+    while (true) {
+        const uint32_t claim = claim_.fetch_add(1);
+        const uint32_t chunk = claim & 0xFFFF;
+        if (chunk >= (claim >> 16)) break;
+        fn_(context_, chunk);
+        done++;
+    }
+    return done;
+}
+
+
+bool CoreHelper::begin(BaseType_t core) {
+    if (task_ != nullptr) return true;
+    if (isHeapSealed()) {
+        debugln("Heap is sealed, the compose helper task is not started");
+        return false;
+    }
+
+    idle_ = xSemaphoreCreateBinary();
+    if (idle_ == nullptr) {
+        debugln("Failed to create the compose helper semaphore");
+        return false;
+    }
+
+    claim_.store(0);
+    inFlight_.store(0);
+    waiting_.store(false);
+    if (xTaskCreatePinnedToCore(helperTask, "CoreHelper", CORE_HELPER_STACK, this, CORE_HELPER_PRIORITY, &task_, core) != pdPASS) {
+        debugln("Failed to create the compose helper task");
+        task_ = nullptr;
+        vSemaphoreDelete(idle_);
+        idle_ = nullptr;
+        return false;
+    }
+    return true;
+}
+
+
+void CoreHelper::end() {
+    if (task_ == nullptr) return;
+
+    // The helper only holds inFlight_ while it drains, never while it waits
+    while (inFlight_.load() != 0) taskYIELD();
+    vTaskDelete(task_);
+    task_ = nullptr;
+    vSemaphoreDelete(idle_);
+    idle_ = nullptr;
+}
+
+
+void CoreHelper::run(ChunkFn fn, void* context, size_t chunks) {
+    if (chunks == 0) return;
+    chunks = std::min<size_t>(chunks, CORE_HELPER_MAX_CHUNKS);
+
+    if (task_ == nullptr) {
+        for (size_t chunk = 0; chunk < chunks; chunk++) fn(context, chunk);
+        return;
+    }
+
+    // Publish the job, then open it with a single store
+    fn_ = fn;
+    context_ = context;
+    boost_.store(std::max<UBaseType_t>(uxTaskPriorityGet(nullptr), CORE_HELPER_PRIORITY), std::memory_order_relaxed);
+    claim_.store(static_cast<uint32_t>(chunks) << 16);
+    xTaskNotifyGive(task_);
+
+    drain();
+
+    // Barrier: block until the helper lets go of a chunk it is still working on. A give
+    // left over from a wait that did not happen only costs one more pass of the loop.
+    while (inFlight_.load() != 0) {
+        waiting_.store(true);
+        if (inFlight_.load() != 0) xSemaphoreTake(idle_, 1);
+        waiting_.store(false);
+    }
+}
@@ -0,0 +1,113 @@
+#pragma once
+#ifndef COREHELPER_H
+#define COREHELPER_H
+
+#include <Arduino.h>
+#include <atomic>
+
+// Stack of the helper task in bytes
+#define CORE_HELPER_STACK 2048
+
+// Priority of the helper task, just above idle so it only soaks up spare time
+#define CORE_HELPER_PRIORITY 1
+
+// Most chunks a job can be split into
+#define CORE_HELPER_MAX_CHUNKS 0x7FFF
+
+
+/**
+ * @brief Splits a job into chunks worked on by the calling core and a helper task on the other core
+ * @details Both sides claim chunks from a shared counter until none are left, so the
+ * split follows whatever time the other core has to spare: when it is busy the helper
+ * never gets to claim a chunk and the caller does them all, without waiting for it.
+ * The helper waits at CORE_HELPER_PRIORITY, so tasks above it on the other core always
+ * come first. While it works on a job it runs at the caller's priority, so the caller
+ * never waits on it for more than one chunk. It is raised once when it wakes for a job
+ * and dropped back once the job has no chunks left, not around every chunk.
+ * Owned and used by a single calling task.
+ */
+class CoreHelper {
+public:
+    /**
+     * @brief Works on one chunk
+     * @param context The context passed to run()
+     * @param chunk The chunk to work on, 0 to chunks - 1
+     */
+    typedef void (*ChunkFn)(void* context, size_t chunk);
+
+private:
+    TaskHandle_t task_ = nullptr;
+    ChunkFn fn_ = nullptr;
+    void* context_ = nullptr;
+    SemaphoreHandle_t idle_ = nullptr;      // Given when the helper lets go of a chunk the caller waits for
+    std::atomic<uint32_t> claim_{0};        // Chunk count in the high half, next chunk to claim in the low half
+    std::atomic<uint32_t> inFlight_{0};     // The helper is claiming or working on a chunk
+    std::atomic<bool> waiting_{false};      // The caller is blocked on idle_
+    std::atomic<UBaseType_t> boost_{CORE_HELPER_PRIORITY};  // Priority of the caller of the current job
+    std::atomic<uint32_t> helped_{0};       // Chunks done by the helper since the last takeHelped()
+
+    static void helperTask(void* parameters);
+
+    /**
+     * @brief Claim and work on one chunk from the helper task
+     * @return False if no chunk was left
+     */
+    bool helpOnce();
+
+    /**
+     * @brief Claim and work on chunks until none are left
+     * @return The number of chunks done
+     * @details The chunk count travels with the claim counter, so a helper that wakes
+     * late for a finished job claims nothing and never reads the next job half set up.
+     */
+    size_t drain();
+
+public:
+    CoreHelper() = default;
+    CoreHelper(const CoreHelper&) = delete;
+    CoreHelper& operator=(const CoreHelper&) = delete;
+
+    ~CoreHelper() {
+        end();
+    }
+
+    /**
+     * @brief Start the helper task
+     * @param core The core to pin it to, the one the calling task is not running on
+     * @return True if the helper is running
+     */
+    bool begin(BaseType_t core);
+
+    /**
+     * @brief Stop the helper task
+     * @details Must not be called while run() is in progress.
+     */
+    void end();
+
+    /**
+     * @brief Checks if the helper task is running
+     */
+    bool isRunning() const {
+        return task_ != nullptr;
+    }
+
+    /**
+     * @brief Work on all chunks of a job, on both cores if the other one has time
+     * @param fn The function to call per chunk. Chunks must touch disjoint data.
+     * @param context Passed to fn
+     * @param chunks The number of chunks, at most CORE_HELPER_MAX_CHUNKS
+     * @details Returns once every chunk is done. Without a running helper, the chunks
+     * are worked on in order by the caller. If the helper still holds a chunk when the
+     * caller runs out, the caller blocks until it is done rather than spin.
+     */
+    void run(ChunkFn fn, void* context, size_t chunks);
+
+    /**
+     * @brief Get and reset the number of chunks the helper has done
+     */
+    uint32_t takeHelped() {
+        return helped_.exchange(0, std::memory_order_relaxed);
+    }
+};
+
+#endif
@@ -0,0 +1,49 @@
+#include "envelope.h"
+#include <array>
+#include <cstddef>
+
+static constexpr size_t EASING_POINTS = 257;
+
+using EasingTable = std::array<uint16_t, EASING_POINTS>;
+
+/**
+ * Sample an easing curve at t in [0, 65536], returning a value in [0, 65535].
+ */
+static constexpr uint32_t ease(Easing easing, uint64_t t) {
+    uint64_t value = t;
+    switch (easing) {
+        case Easing::EaseIn:    value = t * t >> 16; break;
+        case Easing::EaseOut:   value = 65536 - ((65536 - t) * (65536 - t) >> 16); break;
+        case Easing::EaseInOut: value = (t * t >> 16) * (3 * 65536 - 2 * t) >> 16; break;
+        default: break;
+    }
+    return value > 65535 ? 65535 : static_cast<uint32_t>(value);
+}
+
+static constexpr EasingTable buildEasingTable(Easing easing) {
+    EasingTable table{};
+    for (size_t i = 0; i < EASING_POINTS; i++) table[i] = static_cast<uint16_t>(ease(easing, i * 256));
+    return table;
+}
+
+// Built at compile time and kept in flash
+static constexpr EasingTable easingTables[static_cast<size_t>(Easing::Count)] = {
+    buildEasingTable(Easing::Linear),
+    buildEasingTable(Easing::EaseIn),
+    buildEasingTable(Easing::EaseOut),
+    buildEasingTable(Easing::EaseInOut),
+};
+
+
+int32_t Envelope::valueAt(uint32_t nowMs) const {
+    if (isDone(nowMs)) return toValue;
+
+    // Position in [0, 65536), then interpolate between the two nearest table points
+    const uint32_t phase = static_cast<uint32_t>((static_cast<uint64_t>(nowMs - startMs) << 16) / durationMs);
+    const EasingTable& table = easingTables[static_cast<size_t>(easing)];
+    const uint32_t index = phase >> 8;
+    const uint32_t fraction = phase & 0xFF;
+    const uint32_t eased = table[index] + ((static_cast<int32_t>(table[index + 1]) - table[index]) * static_cast<int32_t>(fraction) >> 8);
+
+    return fromValue + static_cast<int32_t>(static_cast<int64_t>(toValue - fromValue) * eased >> 16);
+}
@@ -0,0 +1,82 @@
+#pragma once
+#ifndef ENVELOPE_H
+#define ENVELOPE_H
+
+#include <cstdint>
+
+
+/**
+ * @brief Shape of an envelope between its start and end value
+ */
+enum class Easing : uint8_t {
+    Linear,
+    EaseIn,     // Quadratic, slow start
+    EaseOut,    // Quadratic, slow end
+    EaseInOut,  // Smoothstep, slow start and end
+    Count
+};
+
+
+/**
+ * @brief Convert a value to Q16.16 fixed point
+ */
+constexpr int32_t toQ16(float value) {
+    return static_cast<int32_t>(value * 65536.0f + (value < 0 ? -0.5f : 0.5f));
+}
+
+/**
+ * @brief Convert a Q16.16 fixed point value back to float
+ */
+constexpr float fromQ16(int32_t value) {
+    return value / 65536.0f;
+}
+
+
+/**
+ * @brief A timed transition of one renderer parameter
+ * @details Values are Q16.16 fixed point. The easing curves are precomputed tables
+ * of 257 points, evaluated by linear interpolation, so a sample costs a table
+ * lookup and two integer multiplies.
+ */
+struct Envelope {
+    int32_t fromValue = 0;          // Value at the start
+    int32_t toValue = 0;            // Value at the end
+    uint32_t startMs = 0;           // millis() timestamp the envelope starts at
+    uint32_t durationMs = 0;        // Length of the transition
+    Easing easing = Easing::Linear;
+    bool active = false;
+
+    /**
+     * @brief Start a transition
+     * @param from The value now
+     * @param to The value to end at
+     * @param nowMs The current millis() timestamp
+     * @param duration The length of the transition in milliseconds
+     * @param curve The easing curve
+     */
+    void start(int32_t from, int32_t to, uint32_t nowMs, uint32_t duration, Easing curve) {
+        fromValue = from;
+        toValue = to;
+        startMs = nowMs;
+        durationMs = duration;
+        easing = curve < Easing::Count ? curve : Easing::Linear;
+        active = true;
+    }
+
+    /**
+     * @brief Checks if the transition has reached its end value
+     * @param nowMs The current millis() timestamp
+     */
+    bool isDone(uint32_t nowMs) const {
+        return nowMs - startMs >= durationMs;
+    }
+
+    /**
+     * @brief Sample the envelope
+     * @param nowMs The current millis() timestamp
+     * @return The value at that time, the end value once done
+     */
+    int32_t valueAt(uint32_t nowMs) const;
+};
+
+#endif
@@ -0,0 +1,58 @@
+#include "events.h"
+
+
+void RenderEvents::subscribe(RenderEventType type, RenderEventCallback callback, void* context) {
+    const uint32_t bit = 1u << static_cast<uint32_t>(type);
+
+    // Stop posting first, so the render task never queues an event for a half-set slot
+    subscribed_.fetch_and(~bit, std::memory_order_relaxed);
+    subscriptions_[static_cast<size_t>(type)] = {callback, context};
+    if (callback != nullptr) subscribed_.fetch_or(bit, std::memory_order_relaxed);
+}
+
+
+bool RenderEvents::post(const RenderEvent& event) {
+    if (!wants(event.type)) return false;
+    if (!queue_.push(event)) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    // Pairs with the fence in dispatch(): either it sees the event or this sees the listener
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    TaskHandle_t listener = listener_.load(std::memory_order_relaxed);
+    if (listener != nullptr) xTaskNotifyGive(listener);
+    return true;
+}
+
+
+void RenderEvents::postLoop(AnimationId animation) {
+    if (animation != loopAnimation_) {
+        loopAnimation_ = animation;
+        loops_ = 0;
+    }
+    loops_++;
+    post({RenderEventType::LoopComplete, loops_, animation});
+}
+
+
+size_t RenderEvents::dispatch(TickType_t waitTicks) {
+    if (waitTicks > 0 && queue_.empty()) {
+        listener_.store(xTaskGetCurrentTaskHandle(), std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        // Check again, an event posted before the store notified nobody
+        if (queue_.empty()) ulTaskNotifyTake(pdTRUE, waitTicks);
+        listener_.store(nullptr, std::memory_order_relaxed);
+    }
+
+    size_t dispatched = 0;
+    RenderEvent event;
+    while (queue_.pop(event)) {
+        // Unsubscribed since it was posted
+        const Subscription& subscription = subscriptions_[static_cast<size_t>(event.type)];
+        if (subscription.callback == nullptr) continue;
+        subscription.callback(event, subscription.context);
+        dispatched++;
+    }
+    return dispatched;
+}
@@ -0,0 +1,150 @@
+#pragma once
+#ifndef EVENTS_H
+#define EVENTS_H
+
+#include "animation.h"
+#include "spsc.h"
+
+// Events the render task can queue before the app task dispatches them, a power of two
+#define RENDER_EVENT_QUEUE 32
+
+// Pass to RenderEvents::onFrame() to hear about every frame
+#define RENDER_EVENT_EVERY_FRAME UINT32_MAX
+
+
+enum class RenderEventType : uint8_t {
+    Frame,                  // A watched frame was reached, shown or skipped to keep time, value is its index
+    LoopComplete,           // A repeating animation wrapped around, value counts the loops
+    AnimationFinished,      // A non-repeating animation ended and playback stopped
+    TransitionDone,         // A fade or ramp reached its target, value is a Transition
+    Count
+};
+
+enum class Transition : uint8_t {
+    Brightness,             // Renderer::fadeBrightness()
+    Speed                   // Renderer::rampSpeed()
+};
+
+struct RenderEvent {
+    RenderEventType type = RenderEventType::Frame;
+    uint32_t value = 0;
+    AnimationId animation = 0;      // The animation playing when the event happened
+};
+
+/**
+ * @brief Called on the app task for a render event
+ * @param event The event
+ * @param context The pointer given when subscribing
+ */
+typedef void (*RenderEventCallback)(const RenderEvent& event, void* context);
+
+
+/**
+ * @brief Render events, posted by the render task and dispatched on the app task
+ * @details The render task only posts events someone subscribed to, into a lock-free
+ * queue, and never waits or takes a lock for it. The app task calls dispatch(), which
+ * can block until an event arrives, so playlist or UI logic reacts to playback without
+ * polling isRunning(). Subscribe and dispatch from the same task. If the app task falls
+ * RENDER_EVENT_QUEUE events behind, newer events are dropped and counted.
+ */
+class RenderEvents {
+private:
+    struct Subscription {
+        RenderEventCallback callback = nullptr;
+        void* context = nullptr;
+    };
+
+    SpscQueue<RenderEvent, RENDER_EVENT_QUEUE> queue_;
+    Subscription subscriptions_[static_cast<size_t>(RenderEventType::Count)];
+    std::atomic<uint32_t> subscribed_{0};                   // One bit per RenderEventType with a callback
+    std::atomic<uint32_t> watchedFrame_{0};                 // Frame index for RenderEventType::Frame
+    std::atomic<uint32_t> dropped_{0};
+    std::atomic<TaskHandle_t> listener_{nullptr};           // Task blocked in dispatch(), woken by post()
+    AnimationId loopAnimation_ = 0;                         // Render task only
+    uint32_t loops_ = 0;                                    // Render task only
+
+    void subscribe(RenderEventType type, RenderEventCallback callback, void* context);
+
+public:
+    RenderEvents() = default;
+    RenderEvents(const RenderEvents&) = delete;
+    RenderEvents& operator=(const RenderEvents&) = delete;
+
+    /**
+     * @brief Call back when playback reaches a frame
+     * @param frame The frame index to watch, or RENDER_EVENT_EVERY_FRAME
+     * @param callback The function to call, nullptr to unsubscribe
+     * @param context Passed to the callback
+     */
+    void onFrame(uint32_t frame, RenderEventCallback callback, void* context = nullptr) {
+        watchedFrame_.store(frame, std::memory_order_relaxed);
+        subscribe(RenderEventType::Frame, callback, context);
+    }
+
+    /**
+     * @brief Call back each time a repeating animation starts over
+     */
+    void onLoopComplete(RenderEventCallback callback, void* context = nullptr) {
+        subscribe(RenderEventType::LoopComplete, callback, context);
+    }
+
+    /**
+     * @brief Call back when a non-repeating animation ends
+     */
+    void onAnimationFinished(RenderEventCallback callback, void* context = nullptr) {
+        subscribe(RenderEventType::AnimationFinished, callback, context);
+    }
+
+    /**
+     * @brief Call back when a brightness fade or speed ramp is done
+     */
+    void onTransitionDone(RenderEventCallback callback, void* context = nullptr) {
+        subscribe(RenderEventType::TransitionDone, callback, context);
+    }
+
+    /**
+     * @brief Checks if anyone listens for an event type
+     * @details Lets the render task skip building events nobody wants.
+     */
+    bool wants(RenderEventType type) const {
+        return subscribed_.load(std::memory_order_relaxed) & (1u << static_cast<uint32_t>(type));
+    }
+
+    /**
+     * @brief Queue an event, from the render task only
+     * @return False if nobody subscribed to it or the queue is full
+     */
+    bool post(const RenderEvent& event);
+
+    /**
+     * @brief Queue a frame event if the frame is watched, from the render task only
+     */
+    void postFrame(size_t frame, AnimationId animation) {
+        if (!wants(RenderEventType::Frame)) return;
+        const uint32_t watched = watchedFrame_.load(std::memory_order_relaxed);
+        if (watched != RENDER_EVENT_EVERY_FRAME && watched != frame) return;
+        post({RenderEventType::Frame, static_cast<uint32_t>(frame), animation});
+    }
+
+    /**
+     * @brief Queue a loop event, counting the loops of the animation, from the render task only
+     */
+    void postLoop(AnimationId animation);
+
+    /**
+     * @brief Call back for the queued events, from the app task
+     * @param waitTicks How long to block for a first event, 0 to only drain the queue
+     * @return The number of events dispatched
+     * @details While blocked, the calling task is woken by its task notification.
+     */
+    size_t dispatch(TickType_t waitTicks = 0);
+
+    /**
+     * @brief Get the number of events dropped because the queue was full
+     */
+    uint32_t droppedEvents() const {
+        return dropped_.load(std::memory_order_relaxed);
+    }
+};
+
+#endif
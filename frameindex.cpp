@@ -0,0 +1,222 @@
+#include "frameindex.h"
+#include "jsonscan.h"
+
+// "FIDX" in little-endian order, then the format version
+static constexpr uint32_t FRAME_INDEX_MAGIC = 0x58444946;
+static constexpr uint32_t FRAME_INDEX_VERSION = 1;
+
+/**
+ * @brief Bytes read from the animation file at a time while scanning
+ */
+#define FRAME_INDEX_READ_BYTES 512
+
+
+/**
+ * @brief Header of the sidecar file, followed by one FrameIndex::Entry per frame
+ */
+struct FrameIndexHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t fileSize;
+    uint32_t lastWrite;
+    uint32_t frameCount;
+};
+
+
+bool buildFrameIndex(fs::FS& fs, const std::string& path, FrameIndex& index) {
+    File file = fs.open(path.c_str(), FILE_READ);
+    if (!file || file.isDirectory()) {
+        debugf("Failed to open animation file: %s\n", path.c_str());
+        return false;
+    }
+
+    index.fileSize = file.size();
+    index.lastWrite = static_cast<uint32_t>(file.getLastWrite());
+    index.entries.clear();
+
+    JsonFrameScanner scanner;
+    uint8_t buffer[FRAME_INDEX_READ_BYTES];
+    uint32_t position = 0;
+    size_t count;
+
+    while ((count = file.read(buffer, sizeof(buffer))) > 0) {
+        for (size_t i = 0; i < count; i++, position++) {
+            switch (scanner.feed(static_cast<char>(buffer[i]))) {
+                case JsonFrameScanner::Role::FrameBegin:
+                    index.entries.push_back({position, 0});
+                    break;
+                case JsonFrameScanner::Role::FrameEnd:
+                    index.entries.back().length = position + 1 - index.entries.back().offset;
+                    break;
+                default:
+                    break;
+            }
+        }
+        if (scanner.framesComplete()) break;
+    }
+    file.close();
+
+    if (!scanner.framesComplete()) {
+        debugf("Frames array of %s is incomplete, not indexed\n", path.c_str());
+        index.entries.clear();
+        return false;
+    }
+    return true;
+}
+
+
+/**
+ * @brief Read a sidecar index built from a file of the given size
+ * @details The write time is read into the index, not compared.
+ */
+static bool readFrameIndex(fs::FS& fs, const std::string& indexPath, uint32_t fileSize, FrameIndex& index) {
+    if (!fs.exists(indexPath.c_str())) return false;
+    File file = fs.open(indexPath.c_str(), FILE_READ);
+    if (!file) return false;
+
+    FrameIndexHeader header;
+    bool valid = file.read(reinterpret_cast<uint8_t*>(&header), sizeof(header)) == sizeof(header) &&
+                 header.magic == FRAME_INDEX_MAGIC &&
+                 header.version == FRAME_INDEX_VERSION &&
+                 header.fileSize == fileSize;
+
+    // A corrupt frame count must not wrap the size check and pass it
+    const size_t entrySize = sizeof(FrameIndex::Entry);
+    valid = valid && header.frameCount <= (SIZE_MAX - sizeof(header)) / entrySize;
+    const size_t bytes = valid ? static_cast<size_t>(header.frameCount) * entrySize : 0;
+    valid = valid && file.size() == sizeof(header) + bytes;
+    if (!valid) {
+        file.close();
+        return false;
+    }
+
+    index.fileSize = fileSize;
+    index.lastWrite = header.lastWrite;
+    index.entries.resize(header.frameCount);
+    const bool complete = file.read(reinterpret_cast<uint8_t*>(index.entries.data()), bytes) == bytes;
+    file.close();
+    return complete;
+}
+
+
+/**
+ * @brief Write a sidecar index
+ */
+static bool writeFrameIndex(fs::FS& fs, const std::string& indexPath, const FrameIndex& index) {
+    File file = fs.open(indexPath.c_str(), FILE_WRITE);
+    if (!file) return false;
+
+    const FrameIndexHeader header = {
+        FRAME_INDEX_MAGIC,
+        FRAME_INDEX_VERSION,
+        index.fileSize,
+        index.lastWrite,
+        static_cast<uint32_t>(index.entries.size())
+    };
+    const size_t bytes = index.entries.size() * sizeof(FrameIndex::Entry);
+    const bool written = file.write(reinterpret_cast<const uint8_t*>(&header), sizeof(header)) == sizeof(header) &&
+                         file.write(reinterpret_cast<const uint8_t*>(index.entries.data()), bytes) == bytes;
+    file.close();
+
+    if (!written) fs.remove(indexPath.c_str());
+    return written;
+}
+
+
+/**
+ * @brief Check that every indexed frame still starts with [ and ends with ]
+ * @details Size and write time miss a same-size edit on file systems without write
+ * times, e.g. LittleFS built without mtime support, where the time is always 0.
+ */
+static bool framesLineUp(File& file, const FrameIndex& index) {
+    for (const FrameIndex::Entry& entry : index.entries) {
+        uint8_t open = 0;
+        uint8_t close = 0;
+        if (entry.length < 2 ||
+            !file.seek(entry.offset, fs::SeekSet) || file.read(&open, 1) != 1 ||
+            !file.seek(entry.offset + entry.length - 1, fs::SeekSet) || file.read(&close, 1) != 1 ||
+            open != '[' || close != ']') {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+bool findFrameIndex(fs::FS& fs, const std::string& path, FrameIndex& index) {
+    File file = fs.open(path.c_str(), FILE_READ);
+    if (!file || file.isDirectory()) return false;
+    const uint32_t fileSize = file.size();
+    const uint32_t lastWrite = static_cast<uint32_t>(file.getLastWrite());
+
+    bool found = readFrameIndex(fs, path + FRAME_INDEX_SUFFIX, fileSize, index);
+
+    // A matching write time vouches for the offsets, seek to every frame only without one
+    if (found && (lastWrite == 0 || index.lastWrite != lastWrite)) {
+        found = framesLineUp(file, index);
+        if (!found) {
+            debugf("Frame index of %s is stale\n", path.c_str());
+            index.entries.clear();
+        }
+        index.lastWrite = lastWrite;
+    }
+    file.close();
+    return found;
+}
+
+
+void removeFrameIndex(fs::FS& fs, const std::string& path) {
+    const std::string indexPath = path + FRAME_INDEX_SUFFIX;
+    if (fs.exists(indexPath.c_str())) fs.remove(indexPath.c_str());
+}
+
+
+bool saveFrameIndex(fs::FS& fs, const std::string& path, const FrameIndex& index) {
+    const std::string indexPath = path + FRAME_INDEX_SUFFIX;
+    if (writeFrameIndex(fs, indexPath, index)) return true;
+    debugf("Failed to write frame index %s\n", indexPath.c_str());
+    return false;
+}
+
+
+bool openFrameIndex(fs::FS& fs, const std::string& path, FrameIndex& index) {
+    if (findFrameIndex(fs, path, index)) return true;
+
+    debugf("Building frame index for %s\n", path.c_str());
+    if (!buildFrameIndex(fs, path, index)) return false;
+#ifdef SAVE_FRAME_INDEX
+    saveFrameIndex(fs, path, index);
+#endif
+    return true;
+}
+
+
+bool JsonFrameReader::open(fs::FS& fs, const std::string& path) {
+    close();
+    if (!openFrameIndex(fs, path, index_)) return false;
+
+    file_ = fs.open(path.c_str(), FILE_READ);
+    if (!file_) {
+        debugf("Failed to open animation file: %s\n", path.c_str());
+        index_.entries.clear();
+        return false;
+    }
+    return true;
+}
+
+
+bool JsonFrameReader::seek(size_t frame, Frame& out) {
+    if (frame >= index_.entries.size()) return false;
+    const FrameIndex::Entry& entry = index_.entries[frame];
+
+    if (!file_.seek(entry.offset, fs::SeekSet)) return false;
+    text_.resize(entry.length);
+    if (file_.read(reinterpret_cast<uint8_t*>(&text_[0]), entry.length) != entry.length) return false;
+
+    if (!parseFrameJson(out, text_, doc_)) {
+        debugf("Frame %zu is malformed\n", frame);
+        return false;
+    }
+    normalizeFrame(out);
+    return true;
+}
@@ -0,0 +1,128 @@
+#pragma once
+#ifndef FRAMEINDEX_H
+#define FRAMEINDEX_H
+
+#include "animation.h"
+
+/**
+ * @brief Extension appended to an animation path for its frame index
+ */
+#define FRAME_INDEX_SUFFIX ".idx"
+
+
+/**
+ * @brief Where each frame of an animation JSON file starts and ends
+ * @details Saved next to the animation as a small binary sidecar, so a single frame
+ * can be read and parsed without parsing anything before it. The size and write time
+ * of the JSON file are recorded to detect a stale index. The loaders only save it with
+ * SAVE_FRAME_INDEX defined in io.h, otherwise it is written by saveFrameIndex() alone.
+ */
+struct FrameIndex {
+    struct Entry {
+        uint32_t offset;    // Byte offset of the frame's opening bracket
+        uint32_t length;    // Bytes up to and including the closing bracket
+    };
+
+    uint32_t fileSize = 0;          // Size of the JSON file the index was built from
+    uint32_t lastWrite = 0;         // Write time of the JSON file
+    std::vector<Entry> entries;     // One per frame, in file order
+};
+
+
+/**
+ * @brief Scan an animation file for the position of every frame
+ * @param fs The file system to read from
+ * @param path The path to the animation file
+ * @param index Filled with the frame positions
+ * @return False if the file cannot be read or its frames array is incomplete
+ */
+bool buildFrameIndex(fs::FS& fs, const std::string& path, FrameIndex& index);
+
+
+/**
+ * @brief Read the sidecar index of an animation file, never building one
+ * @param fs The file system the animation is on
+ * @param path The path to the animation file
+ * @param index Filled with the frame positions
+ * @return False if the sidecar is missing, stale or corrupt
+ * @details The size must match. If the write time does not, or the file system keeps
+ * none, every indexed frame must still start with [ and end with ], which catches a
+ * same-size edit where write times are not kept.
+ */
+bool findFrameIndex(fs::FS& fs, const std::string& path, FrameIndex& index);
+
+
+/**
+ * @brief Delete the sidecar index of an animation file
+ * @param fs The file system the animation is on
+ * @param path The path to the animation file, not the sidecar
+ * @details For an index that passed findFrameIndex() but led to a frame that does not
+ * parse, so the next load scans the file again.
+ */
+void removeFrameIndex(fs::FS& fs, const std::string& path);
+
+
+/**
+ * @brief Write the sidecar index of an animation file
+ * @param fs The file system the animation is on
+ * @param path The path to the animation file, not the sidecar
+ * @param index The frame positions, with the size and write time of the file
+ * @return False if the sidecar could not be written
+ */
+bool saveFrameIndex(fs::FS& fs, const std::string& path, const FrameIndex& index);
+
+
+/**
+ * @brief Get the frame index of an animation file, creating the sidecar on first use
+ * @param fs The file system the animation is on
+ * @param path The path to the animation file
+ * @param index Filled with the frame positions
+ * @return False if there is no valid index and none could be built
+ * @details A missing or stale sidecar is rebuilt by scanning the file once. The new
+ * index is saved only with SAVE_FRAME_INDEX defined in io.h, and returned either way.
+ */
+bool openFrameIndex(fs::FS& fs, const std::string& path, FrameIndex& index);
+
+
+/**
+ * @brief Random access to the frames of an animation JSON file
+ * @details Seeks straight to a frame through the sidecar index and parses only its
+ * array. The text buffer and document are reused, so reading frames in a loop, e.g.
+ * for streamed playback, does not parse the rest of the file.
+ */
+struct JsonFrameReader {
+private:
+    File file_;
+    FrameIndex index_;
+    std::string text_;      // JSON text of the last frame read
+    JsonDocument doc_;
+
+public:
+    /**
+     * @brief Open an animation file and its index
+     * @return False if the file cannot be opened or indexed
+     */
+    bool open(fs::FS& fs, const std::string& path);
+
+    void close() {
+        file_.close();
+        index_.entries.clear();
+    }
+
+    /**
+     * @brief Get the number of frames in the open file
+     */
+    size_t frameCount() const {
+        return index_.entries.size();
+    }
+
+    /**
+     * @brief Read one frame
+     * @param frame The frame index
+     * @param out The frame to fill, normalized with normalizeFrame()
+     * @return False if the index is out of range or the frame is malformed
+     */
+    bool seek(size_t frame, Frame& out);
+};
+
+#endif
@@ -0,0 +1,105 @@
+#include "heapguard.h"
+#include <esp_heap_caps.h>
+#include <atomic>
+#include <new>
+#include <cstdlib>
+
+static std::atomic<bool> sealed{false};
+static std::atomic<uint32_t> allocationsAfterSeal{0};
+static std::atomic<uint32_t> lastAllocationSize{0};
+static size_t freeAtSeal = 0;
+
+
+void sealHeap(void) {
+    freeAtSeal = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    allocationsAfterSeal.store(0, std::memory_order_relaxed);
+    sealed.store(true, std::memory_order_release);
+    debugf("Heap sealed with %zu bytes free\n", freeAtSeal);
+}
+
+
+bool isHeapSealed(void) {
+    return sealed.load(std::memory_order_acquire);
+}
+
+
+uint32_t heapAllocationsAfterSeal(void) {
+    return allocationsAfterSeal.load(std::memory_order_relaxed);
+}
+
+
+size_t heapDriftSinceSeal(void) {
+    if (!isHeapSealed()) return 0;
+    const size_t freeNow = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    return freeNow < freeAtSeal ? freeAtSeal - freeNow : 0;
+}
+
+
+void printHeapReport(void) {
+    debugf("Free heap: %zu bytes, drift since seal: %zu bytes\n", heap_caps_get_free_size(MALLOC_CAP_8BIT), heapDriftSinceSeal());
+    debugf("Allocations after seal: %lu (last %lu bytes)\n",
+        (unsigned long)heapAllocationsAfterSeal(),
+        (unsigned long)lastAllocationSize.load(std::memory_order_relaxed)
+    );
+}
+
+
+#ifdef STATIC_ALLOC
+
+/**
+ * @brief Count an allocation made after the heap was sealed
+ * @details Runs inside operator new, so it must not allocate or print itself.
+ */
+static inline void noteAllocation(size_t size) {
+    if (!sealed.load(std::memory_order_relaxed)) return;
+    allocationsAfterSeal.fetch_add(1, std::memory_order_relaxed);
+    lastAllocationSize.store(static_cast<uint32_t>(size), std::memory_order_relaxed);
+#ifdef STATIC_ALLOC_ABORT
+    abort();
+#endif
+}
+
+void* operator new(size_t size) {
+    noteAllocation(size);
+    void* ptr = malloc(size);
+    if (ptr == nullptr) {
+#if __cpp_exceptions
+        throw std::bad_alloc();
+#else
+        abort();
+#endif
+    }
+    return ptr;
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    noteAllocation(size);
+    return malloc(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    noteAllocation(size);
+    return malloc(size);
+}
+
+void operator delete(void* ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept {
+    free(ptr);
+}
+
+#endif
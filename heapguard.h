@@ -0,0 +1,47 @@
+#pragma once
+#ifndef HEAPGUARD_H
+#define HEAPGUARD_H
+
+#include "io.h"
+#include <cstdint>
+#include <cstddef>
+
+
+/**
+ * @brief Declare the heap layout final
+ * @details Call at the end of setup(), once the output buffer, animations and tasks
+ * exist. From then on, operations that would allocate (copying an animation in,
+ * adding segments, growing the frame stager) are refused. With
+ * STATIC_ALLOC defined, every operator new after this point is also counted, and
+ * aborts when STATIC_ALLOC_ABORT is defined too.
+ */
+void sealHeap(void);
+
+
+/**
+ * @brief Checks if sealHeap() has been called
+ */
+bool isHeapSealed(void);
+
+
+/**
+ * @brief Get the number of operator new calls since sealHeap()
+ * @return The count, always 0 unless STATIC_ALLOC is defined
+ */
+uint32_t heapAllocationsAfterSeal(void);
+
+
+/**
+ * @brief Get how much the free heap shrank since sealHeap()
+ * @details Catches C allocations from libraries that bypass operator new.
+ * @return The bytes lost, 0 if the heap is as free as when it was sealed
+ */
+size_t heapDriftSinceSeal(void);
+
+
+/**
+ * @brief Print the free heap, the drift and the allocations since sealHeap()
+ */
+void printHeapReport(void);
+
+#endif
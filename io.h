@@ -11,6 +11,15 @@
 
 #define DEBUG 1
 
+// Uncomment to allocate the render task statically and count heap use after sealHeap()
+// #define STATIC_ALLOC 1
+// Uncomment as well to abort on the first allocation after sealHeap()
+// #define STATIC_ALLOC_ABORT 1
+// Uncomment to check the pixel kernels against their references at boot, the only check of the PIE paths
+// #define KERNEL_CHECK 1
+// Uncomment to let the loaders save the frame index of a JSON animation next to it, see frameindex.h
+// #define SAVE_FRAME_INDEX 1
+
 #ifdef DEBUG
     #define debug(...) Serial.print(__VA_ARGS__)
     #define debugln(...) Serial.println(__VA_ARGS__)
@@ -0,0 +1,105 @@
+#pragma once
+#ifndef JSONSCAN_H
+#define JSONSCAN_H
+
+#include <cstdint>
+#include <cstring>
+
+
+/**
+ * @brief Character-level scanner that finds the frames of an animation JSON document
+ * @details Feed the document one character at a time. Each character is classified
+ * as part of the surrounding document or of a frame, so callers can cut single
+ * frames out of the text without parsing the rest. The frames array itself stays
+ * part of the document as an empty "frames": [].
+ */
+struct JsonFrameScanner {
+    enum class Role : uint8_t {
+        Document,   // Outside the frames array
+        Separator,  // Between two frames inside the frames array
+        FrameBegin, // Opening bracket of a frame
+        Frame,      // Inside a frame
+        FrameEnd    // Closing bracket of a frame
+    };
+
+private:
+    uint16_t depth_ = 0;            // Nesting depth, 1 inside the top-level object
+    bool inString_ = false;
+    bool escaped_ = false;
+    bool inFrames_ = false;         // Inside the frames array
+    bool framesDone_ = false;       // The frames array has been closed
+    char key_[8] = {0};             // Last key at depth 1, only needs to fit "frames"
+    uint8_t keyLength_ = 0;
+    bool lastKeyIsFrames_ = false;
+
+    Role outside() const {
+        if (!inFrames_) return Role::Document;
+        return depth_ >= 3 ? Role::Frame : Role::Separator;
+    }
+
+public:
+    /**
+     * @brief Classify the next character of the document
+     * @param c The character
+     * @return The role of the character
+     */
+    Role feed(char c) {
+        if (inString_) {
+            if (escaped_) {
+                escaped_ = false;
+            } else if (c == '\\') {
+                escaped_ = true;
+            } else if (c == '"') {
+                inString_ = false;
+                if (depth_ == 1 && !inFrames_) {
+                    lastKeyIsFrames_ = keyLength_ == 6 && memcmp(key_, "frames", 6) == 0;
+                }
+            } else if (depth_ == 1 && !inFrames_ && keyLength_ < sizeof(key_)) {
+                key_[keyLength_++] = c;
+            }
+            return outside();
+        }
+
+        switch (c) {
+            case '"':
+                inString_ = true;
+                keyLength_ = 0;
+                return outside();
+
+            case '[':
+            case '{':
+                if (!inFrames_ && !framesDone_ && depth_ == 1 && c == '[' && lastKeyIsFrames_) {
+                    inFrames_ = true;
+                    depth_++;
+                    return Role::Document;
+                }
+                depth_++;
+                if (inFrames_ && depth_ == 3) return Role::FrameBegin;
+                return outside();
+
+            case ']':
+            case '}':
+                if (inFrames_ && depth_ == 2) {
+                    inFrames_ = false;
+                    framesDone_ = true;
+                    depth_--;
+                    return Role::Document;
+                }
+                if (depth_ > 0) depth_--;
+                if (inFrames_ && depth_ == 2) return Role::FrameEnd;
+                return outside();
+
+            default:
+                return outside();
+        }
+    }
+
+    /**
+     * @brief Checks if the whole frames array has been scanned
+     */
+    bool framesComplete() const {
+        return framesDone_;
+    }
+};
+
+#endif
@@ -0,0 +1,294 @@
+#include "kernels.h"
+#include <algorithm>
+#include <string.h>
+
+
+void scalePixelsReference(uint8_t* data, size_t bytes, uint8_t scale) {
+    for (size_t i = 0; i < bytes; i++) data[i] = static_cast<uint8_t>((data[i] * scale) >> 8);
+}
+
+void addPixelsReference(uint8_t* dst, const uint8_t* src, size_t bytes) {
+    for (size_t i = 0; i < bytes; i++) dst[i] = static_cast<uint8_t>(std::min(dst[i] + src[i], 255));
+}
+
+void lerpPixelsReference(uint8_t* out, const uint8_t* a, const uint8_t* b, size_t bytes, uint8_t weight) {
+    for (size_t i = 0; i < bytes; i++) {
+        out[i] = static_cast<uint8_t>(a[i] - ((a[i] * weight) >> 8) + ((b[i] * weight) >> 8));
+    }
+}
+
+
+/**
+ * @brief Bytes before p reaches an align-byte boundary, at most bytes
+ * @details The word and vector loops only run on aligned blocks, the references
+ * handle the head and tail.
+ */
+static inline size_t headBytes(const void* p, size_t bytes, uintptr_t align) {
+    return std::min<size_t>((align - (reinterpret_cast<uintptr_t>(p) & (align - 1))) & (align - 1), bytes);
+}
+
+/**
+ * @brief Checks if two buffers can be walked in aligned blocks together
+ */
+static inline bool samePhase(const void* a, const void* b, uintptr_t align) {
+    return ((reinterpret_cast<uintptr_t>(a) ^ reinterpret_cast<uintptr_t>(b)) & (align - 1)) == 0;
+}
+
+
+#ifdef KERNELS_PIE
+// EE.VLD.128 and EE.VST.128 ignore the low address bits
+#define KERNEL_ALIGN 16
+#else
+// Xtensa and RISC-V cores fault or trap on unaligned word access
+#define KERNEL_ALIGN 4
+#endif
+
+
+#ifdef KERNELS_PIE
+static inline void scaleBlocks(uint8_t* data, size_t blocks, uint8_t scale) {
+    // EE.VMUL.U8 shifts the 16-bit products right by SAR
+    asm volatile(
+        "wsr.sar %[shift]\n\t"
+        "ee.vldbc.8 q1, %[scale]\n\t"
+        "loopnez %[blocks], 0f\n\t"
+        "ee.vld.128.ip q0, %[data], 0\n\t"
+        "ee.vmul.u8 q0, q0, q1\n\t"
+        "ee.vst.128.ip q0, %[data], 16\n\t"
+        "0:\n\t"
+        : [data] "+r"(data)
+        : [blocks] "r"(blocks), [scale] "r"(&scale), [shift] "r"(8)
+        : "memory"
+    );
+}
+
+static inline void addBlocks(uint8_t* dst, const uint8_t* src, size_t blocks) {
+    asm volatile(
+        "loopnez %[blocks], 0f\n\t"
+        "ee.vld.128.ip q0, %[dst], 0\n\t"
+        "ee.vld.128.ip q1, %[src], 16\n\t"
+        "ee.vadds.u8 q0, q0, q1\n\t"
+        "ee.vst.128.ip q0, %[dst], 16\n\t"
+        "0:\n\t"
+        : [dst] "+r"(dst), [src] "+r"(src)
+        : [blocks] "r"(blocks)
+        : "memory"
+    );
+}
+
+static inline void lerpBlocks(uint8_t* out, const uint8_t* a, const uint8_t* b, size_t blocks, uint8_t weight) {
+    // a - (a * w >> 8) never goes below 0 and the sum never passes 255, so the
+    // saturating ops give the exact reference result
+    asm volatile(
+        "wsr.sar %[shift]\n\t"
+        "ee.vldbc.8 q3, %[weight]\n\t"
+        "loopnez %[blocks], 0f\n\t"
+        "ee.vld.128.ip q0, %[a], 16\n\t"
+        "ee.vld.128.ip q1, %[b], 16\n\t"
+        "ee.vmul.u8 q2, q0, q3\n\t"
+        "ee.vmul.u8 q1, q1, q3\n\t"
+        "ee.vsubs.u8 q0, q0, q2\n\t"
+        "ee.vadds.u8 q0, q0, q1\n\t"
+        "ee.vst.128.ip q0, %[out], 16\n\t"
+        "0:\n\t"
+        : [out] "+r"(out), [a] "+r"(a), [b] "+r"(b)
+        : [blocks] "r"(blocks), [weight] "r"(&weight), [shift] "r"(8)
+        : "memory"
+    );
+}
+
+#else
+
+/**
+ * @brief Scale the four channels packed in a word
+ * @details The even and odd bytes are multiplied as two 16-bit lanes each, a product
+ * is at most 255 * 255 and never carries into the next lane.
+ */
+static inline uint32_t scaleWord(uint32_t x, uint32_t scale) {
+    const uint32_t even = (((x & 0x00FF00FF) * scale) >> 8) & 0x00FF00FF;
+    const uint32_t odd = (((x >> 8) & 0x00FF00FF) * scale) & 0xFF00FF00;
+    return even | odd;
+}
+
+/**
+ * @brief Add the four channels packed in two words, saturating each at 255
+ * @details The low 7 bits of each byte are added without crossing into the next byte,
+ * the top bit and the carry out are worked out from it. Bytes that carried are set to 255.
+ */
+static inline uint32_t addWord(uint32_t a, uint32_t b) {
+    const uint32_t low = (a & 0x7F7F7F7F) + (b & 0x7F7F7F7F);
+    const uint32_t sum = low ^ ((a ^ b) & 0x80808080);
+    const uint32_t carry = ((a & b) | ((a | b) & low)) & 0x80808080;
+    return sum | ((carry >> 7) * 0xFF);
+}
+
+/**
+ * @brief Load and store a word of channels
+ * @details Through memcpy, the byte buffers are not uint32_t objects. On an aligned
+ * address it compiles to a single l32i or s32i.
+ */
+static inline uint32_t loadWord(const uint8_t* p) {
+    uint32_t word;
+    memcpy(&word, p, sizeof(word));
+    return word;
+}
+
+static inline void storeWord(uint8_t* p, uint32_t word) {
+    memcpy(p, &word, sizeof(word));
+}
+
+static inline void scaleBlocks(uint8_t* data, size_t blocks, uint8_t scale) {
+    for (size_t i = 0; i < blocks; i++, data += 4) storeWord(data, scaleWord(loadWord(data), scale));
+}
+
+static inline void addBlocks(uint8_t* dst, const uint8_t* src, size_t blocks) {
+    for (size_t i = 0; i < blocks; i++, dst += 4, src += 4) storeWord(dst, addWord(loadWord(dst), loadWord(src)));
+}
+
+static inline void lerpBlocks(uint8_t* out, const uint8_t* a, const uint8_t* b, size_t blocks, uint8_t weight) {
+    for (size_t i = 0; i < blocks; i++, out += 4, a += 4, b += 4) {
+        // Per byte a >= a * w >> 8 and the result stays within 255, so neither the
+        // subtraction nor the addition borrows or carries across bytes
+        const uint32_t x = loadWord(a);
+        storeWord(out, x - scaleWord(x, weight) + scaleWord(loadWord(b), weight));
+    }
+}
+
+#endif
+
+
+void scalePixels(uint8_t* data, size_t bytes, uint8_t scale) {
+    const size_t head = headBytes(data, bytes, KERNEL_ALIGN);
+    scalePixelsReference(data, head, scale);
+    data += head;
+    bytes -= head;
+
+    const size_t blocks = bytes / KERNEL_ALIGN;
+    if (blocks > 0) scaleBlocks(data, blocks, scale);
+    data += blocks * KERNEL_ALIGN;
+    scalePixelsReference(data, bytes % KERNEL_ALIGN, scale);
+}
+
+
+void addPixels(uint8_t* dst, const uint8_t* src, size_t bytes) {
+    if (!samePhase(dst, src, KERNEL_ALIGN)) {
+        addPixelsReference(dst, src, bytes);
+        return;
+    }
+
+    const size_t head = headBytes(dst, bytes, KERNEL_ALIGN);
+    addPixelsReference(dst, src, head);
+    dst += head;
+    src += head;
+    bytes -= head;
+
+    const size_t blocks = bytes / KERNEL_ALIGN;
+    if (blocks > 0) addBlocks(dst, src, blocks);
+    dst += blocks * KERNEL_ALIGN;
+    src += blocks * KERNEL_ALIGN;
+    addPixelsReference(dst, src, bytes % KERNEL_ALIGN);
+}
+
+
+void lerpPixels(uint8_t* out, const uint8_t* a, const uint8_t* b, size_t bytes, uint8_t weight) {
+    if (!samePhase(out, a, KERNEL_ALIGN) || !samePhase(out, b, KERNEL_ALIGN)) {
+        lerpPixelsReference(out, a, b, bytes, weight);
+        return;
+    }
+
+    const size_t head = headBytes(out, bytes, KERNEL_ALIGN);
+    lerpPixelsReference(out, a, b, head, weight);
+    out += head;
+    a += head;
+    b += head;
+    bytes -= head;
+
+    const size_t blocks = bytes / KERNEL_ALIGN;
+    if (blocks > 0) lerpBlocks(out, a, b, blocks, weight);
+    out += blocks * KERNEL_ALIGN;
+    a += blocks * KERNEL_ALIGN;
+    b += blocks * KERNEL_ALIGN;
+    lerpPixelsReference(out, a, b, bytes % KERNEL_ALIGN, weight);
+}
+
+
+/**
+ * @brief Xorshift, the same cases on the host and the board
+ */
+static inline uint32_t nextRandom(uint32_t& state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+static void fillRandom(uint8_t* data, size_t bytes, uint32_t& state) {
+    for (size_t i = 0; i < bytes; i++) data[i] = static_cast<uint8_t>(nextRandom(state));
+}
+
+
+const char* checkKernels(uint32_t seed, size_t rounds) {
+    // Largest random case and the most a buffer is moved off its alignment
+    static const size_t MAX_BYTES = 384;
+    static const size_t MAX_OFFSET = 31;
+    static const size_t SPAN = MAX_BYTES + MAX_OFFSET + 16;
+    alignas(16) uint8_t a[SPAN], b[SPAN], got[SPAN], want[SPAN];
+    uint32_t state = seed != 0 ? seed : 1;
+
+    // Every channel value against every value of a second channel, through every weight
+    for (size_t i = 0; i < 256; i++) a[i] = static_cast<uint8_t>(i);
+    for (unsigned high = 0; high < 256; high++) {
+        memset(b, static_cast<int>(high), 256);
+        for (unsigned w = 0; w < 256; w++) {
+            lerpPixels(got, a, b, 256, static_cast<uint8_t>(w));
+            lerpPixelsReference(want, a, b, 256, static_cast<uint8_t>(w));
+            if (memcmp(got, want, 256) != 0) return "lerpPixels";
+        }
+        memcpy(got, a, 256);
+        memcpy(want, a, 256);
+        addPixels(got, b, 256);
+        addPixelsReference(want, b, 256);
+        if (memcmp(got, want, 256) != 0) return "addPixels";
+
+        memcpy(got, a, 256);
+        memcpy(want, a, 256);
+        scalePixels(got, 256, static_cast<uint8_t>(high));
+        scalePixelsReference(want, 256, static_cast<uint8_t>(high));
+        if (memcmp(got, want, 256) != 0) return "scalePixels";
+    }
+
+    // Random cases compare the whole span, so a write past the end is caught too
+    for (size_t round = 0; round < rounds; round++) {
+        const size_t bytes = nextRandom(state) % (MAX_BYTES + 1);
+        const size_t offsetA = nextRandom(state) % (MAX_OFFSET + 1);
+        // Half the cases share the alignment phase and reach the word or vector loop
+        const size_t offsetB = (nextRandom(state) & 1) ? offsetA : nextRandom(state) % (MAX_OFFSET + 1);
+        const uint8_t weight = static_cast<uint8_t>(nextRandom(state));
+        fillRandom(a, SPAN, state);
+        fillRandom(b, SPAN, state);
+
+        fillRandom(got, SPAN, state);
+        memcpy(want, got, SPAN);
+        scalePixels(got + offsetA, bytes, weight);
+        scalePixelsReference(want + offsetA, bytes, weight);
+        if (memcmp(got, want, SPAN) != 0) return "scalePixels";
+
+        fillRandom(got, SPAN, state);
+        memcpy(want, got, SPAN);
+        addPixels(got + offsetA, b + offsetB, bytes);
+        addPixelsReference(want + offsetA, b + offsetB, bytes);
+        if (memcmp(got, want, SPAN) != 0) return "addPixels";
+
+        fillRandom(got, SPAN, state);
+        memcpy(want, got, SPAN);
+        lerpPixels(got + offsetA, a + offsetA, b + offsetB, bytes, weight);
+        lerpPixelsReference(want + offsetA, a + offsetA, b + offsetB, bytes, weight);
+        if (memcmp(got, want, SPAN) != 0) return "lerpPixels";
+
+        fillRandom(got, SPAN, state);
+        memcpy(want, got, SPAN);
+        blendPixels(got + offsetA, b + offsetB, bytes, weight);
+        lerpPixelsReference(want + offsetA, want + offsetA, b + offsetB, bytes, weight);
+        if (memcmp(got, want, SPAN) != 0) return "blendPixels";
+    }
+    return nullptr;
+}
@@ -0,0 +1,86 @@
+#pragma once
+#ifndef KERNELS_H
+#define KERNELS_H
+
+// The host build in tools/kernelcheck has no sdkconfig.h and gets the SWAR paths
+#if __has_include(<sdkconfig.h>)
+#include <sdkconfig.h>
+#endif
+#include <cstdint>
+#include <cstddef>
+
+// Use the ESP32-S3 PIE 128-bit vector instructions, elsewhere (ESP32, C3) four
+// channels at a time in 32-bit words
+#if defined(CONFIG_IDF_TARGET_ESP32S3)
+    #define KERNELS_PIE 1
+#else
+    #define KERNELS_SWAR 1
+#endif
+
+
+/**
+ * @brief Pixel kernels over tightly packed 8-bit channels
+ * @details Each kernel has a portable reference implementation, the *Reference
+ * functions, and an entry point that uses the fastest implementation the target has,
+ * picked at compile time: PIE vectors on the S3, packed words (SWAR) elsewhere.
+ * They are bit-exact: a vector or word path computes exactly what the reference does,
+ * which tools/kernelcheck checks on the host and checkKernels() on the board.
+ * They are for composing RGB buffers in the app before Renderer::writeRgb(), the
+ * renderer itself maps frames through its output tables pixel by pixel.
+ * Sizes are in bytes, so the same kernels work on RGB and RGBW buffers.
+ */
+
+/**
+ * @brief Scale every channel: data[i] = data[i] * scale >> 8
+ * @param data The channels, scaled in place
+ * @param bytes The number of channels
+ * @param scale The factor in 0.8 fixed point, 255 is just under 1.0
+ */
+void scalePixels(uint8_t* data, size_t bytes, uint8_t scale);
+void scalePixelsReference(uint8_t* data, size_t bytes, uint8_t scale);
+
+/**
+ * @brief Add one buffer to another, saturating at 255: dst[i] = min(dst[i] + src[i], 255)
+ * @param dst The channels to add to
+ * @param src The channels to add
+ * @param bytes The number of channels
+ */
+void addPixels(uint8_t* dst, const uint8_t* src, size_t bytes);
+void addPixelsReference(uint8_t* dst, const uint8_t* src, size_t bytes);
+
+/**
+ * @brief Interpolate between two buffers: out[i] = a - (a * weight >> 8) + (b * weight >> 8)
+ * @param out The result, may be a or b
+ * @param a The channels at weight 0
+ * @param b The channels at weight 255
+ * @param bytes The number of channels
+ * @param weight The position between a and b
+ * @details Exactly a at weight 0, within 1 of b at 255. The two products are rounded
+ * down separately so the vector and word paths can compute them in 8 bits.
+ */
+void lerpPixels(uint8_t* out, const uint8_t* a, const uint8_t* b, size_t bytes, uint8_t weight);
+void lerpPixelsReference(uint8_t* out, const uint8_t* a, const uint8_t* b, size_t bytes, uint8_t weight);
+
+/**
+ * @brief Blend a buffer over another in place, lerpPixels() with out = dst
+ * @param dst The channels blended into
+ * @param src The channels to blend in
+ * @param bytes The number of channels
+ * @param weight The weight of src
+ */
+inline void blendPixels(uint8_t* dst, const uint8_t* src, size_t bytes, uint8_t weight) {
+    lerpPixels(dst, dst, src, bytes, weight);
+}
+
+/**
+ * @brief Run every entry point against its reference on the target it was built for
+ * @param seed The seed of the random cases
+ * @param rounds The number of random cases per kernel
+ * @return nullptr if every kernel matches, else the name of the first that does not
+ * @details Every channel value through every scale and weight, then random lengths,
+ * buffer offsets and weights. Uses only stack buffers, so it can run on the board,
+ * where it is the only check of the PIE paths, see KERNEL_CHECK in io.h.
+ */
+const char* checkKernels(uint32_t seed = 1, size_t rounds = 2000);
+
+#endif
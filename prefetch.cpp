@@ -0,0 +1,157 @@
+#include "prefetch.h"
+#include "heapguard.h"
+
+#if ESP_IDF_VERSION_MAJOR >= 5
+    #include <esp_memory_utils.h>
+#else
+    #include <soc/soc_memory_layout.h>
+#endif
+
+
+#ifdef PREFETCH_ASYNC_MEMCPY
+bool IRAM_ATTR FrameStager::onCopyDone(async_memcpy_handle_t handle, async_memcpy_event_t* event, void* args) {
+    FrameStager* stager = static_cast<FrameStager*>(args);
+    BaseType_t woken = pdFALSE;
+    xSemaphoreGiveFromISR(stager->done_, &woken);
+    return woken == pdTRUE;
+}
+#endif
+
+
+#ifdef PREFETCH_ASYNC_MEMCPY
+void FrameStager::installDma() {
+    if (done_ == nullptr) done_ = xSemaphoreCreateBinary();
+    async_memcpy_config_t config = ASYNC_MEMCPY_DEFAULT_CONFIG();
+    config.psram_trans_align = 16;
+    config.sram_trans_align = 4;
+    if (done_ == nullptr || esp_async_memcpy_install(&config, &dma_) != ESP_OK) {
+        dma_ = nullptr;
+        debugln("Async memcpy unavailable, staging with memcpy");
+    }
+}
+#endif
+
+
+bool FrameStager::begin(size_t maxPixels, const std::shared_ptr<const Animation>& animation) {
+    // Forget anything staged for a previous animation. The weak pointer tells a frame of
+    // this animation from one that was freed and whose address was reused.
+    if (owner_.lock() != animation) source_ = nullptr;
+    owner_ = animation;
+    waitForCopy();
+
+    maxPixels = std::min<size_t>(maxPixels, PREFETCH_MAX_PIXELS);
+    if (maxPixels <= capacity_) return buffer_ != nullptr;
+
+    // Keep the existing buffer, larger frames are composed in place
+    if (isHeapSealed()) return buffer_ != nullptr;
+    if (buffer_ != nullptr) heap_caps_free(buffer_);
+    source_ = nullptr;
+
+    // DMA-capable internal RAM, 16-byte aligned for the GDMA burst size
+    buffer_ = static_cast<Pixel*>(heap_caps_aligned_alloc(16, maxPixels * sizeof(Pixel), MALLOC_CAP_INTERNAL | MALLOC_CAP_DMA));
+    capacity_ = buffer_ != nullptr ? maxPixels : 0;
+    if (buffer_ == nullptr) {
+        debugf("No internal RAM for a %zu pixel staging buffer, composing in place\n", maxPixels);
+        return false;
+    }
+
+#ifdef PREFETCH_ASYNC_MEMCPY
+    if (dma_ == nullptr) installDma();
+#endif
+
+    debugf("Frame staging buffer of %zu pixels allocated\n", capacity_);
+    return true;
+}
+
+
+void FrameStager::end() {
+    waitForCopy();
+
+#ifdef PREFETCH_ASYNC_MEMCPY
+    if (dma_ != nullptr) esp_async_memcpy_uninstall(dma_);
+    if (done_ != nullptr) vSemaphoreDelete(done_);
+    dma_ = nullptr;
+    done_ = nullptr;
+#endif
+
+    if (buffer_ != nullptr) heap_caps_free(buffer_);
+    buffer_ = nullptr;
+    capacity_ = 0;
+    source_ = nullptr;
+    owner_.reset();
+}
+
+
+bool FrameStager::waitForCopy() {
+    if (!inFlight_) return true;
+
+#ifdef PREFETCH_ASYNC_MEMCPY
+    if (xSemaphoreTake(done_, pdMS_TO_TICKS(10)) == pdTRUE) {
+        inFlight_ = false;
+        return true;
+    }
+
+    // Uninstalling deletes the DMA channel, after that nothing writes into the buffer.
+    // Drop a completion that raced the timeout so it cannot end the next copy early.
+    debugln("Frame prefetch timed out, restarting async memcpy");
+    esp_async_memcpy_uninstall(dma_);
+    dma_ = nullptr;
+    xSemaphoreTake(done_, 0);
+    // The driver allocates, after sealHeap() frames are staged with memcpy from here on
+    if (!isHeapSealed()) installDma();
+#endif
+
+    inFlight_ = false;
+    source_ = nullptr;
+    return false;
+}
+
+
+void FrameStager::prefetch(const Frame& frame) {
+    waitForCopy();
+    source_ = nullptr;
+    if (buffer_ == nullptr || frame.empty() || frame.size() > capacity_) return;
+
+    // Internal RAM is already fast, only frames in PSRAM are worth staging
+    if (!esp_ptr_external_ram(frame.data())) return;
+
+    const size_t bytes = frame.size() * sizeof(Pixel);
+    asyncBytes_ = 0;
+
+#ifdef PREFETCH_ASYNC_MEMCPY
+    const size_t alignedBytes = bytes & ~static_cast<size_t>(15);
+    const bool aligned = (reinterpret_cast<uintptr_t>(frame.data()) & 15) == 0;
+    if (dma_ != nullptr && aligned && alignedBytes > 0) {
+        inFlight_ = true;
+        if (esp_async_memcpy(dma_, buffer_, const_cast<Pixel*>(frame.data()), alignedBytes, onCopyDone, this) == ESP_OK) {
+            asyncBytes_ = alignedBytes;
+        } else {
+            inFlight_ = false;
+        }
+    }
+#endif
+
+    // Without DMA, copy now: it is idle time either way
+    if (asyncBytes_ == 0) memcpy(static_cast<void*>(buffer_), frame.data(), bytes);
+
+    source_ = &frame;
+    count_ = frame.size();
+}
+
+
+const Pixel* FrameStager::take(const Frame& frame, size_t& count) {
+    count = frame.size();
+    if (source_ != &frame || count_ != frame.size()) return frame.data();
+
+    if (!waitForCopy()) return frame.data();
+
+    // Tail the DMA transfer could not cover because of its alignment
+    const size_t bytes = count_ * sizeof(Pixel);
+    if (asyncBytes_ > 0 && asyncBytes_ < bytes) {
+        memcpy(reinterpret_cast<uint8_t*>(buffer_) + asyncBytes_, reinterpret_cast<const uint8_t*>(frame.data()) + asyncBytes_, bytes - asyncBytes_);
+    }
+    asyncBytes_ = 0;
+
+    source_ = nullptr;
+    return buffer_;
+}
@@ -0,0 +1,98 @@
+#pragma once
+#ifndef PREFETCH_H
+#define PREFETCH_H
+
+#include "animation.h"
+#include <esp_heap_caps.h>
+#include <esp_idf_version.h>
+
+// Copy with the GDMA async memcpy engine where the target and IDF support it
+#if defined(CONFIG_IDF_TARGET_ESP32S3) && defined(CONFIG_SPIRAM) && ESP_IDF_VERSION_MAJOR >= 5
+    #define PREFETCH_ASYNC_MEMCPY 1
+    #include <esp_async_memcpy.h>
+#endif
+
+/**
+ * @brief Largest frame, in pixels, that is staged in internal SRAM
+ */
+#define PREFETCH_MAX_PIXELS 2048
+
+
+/**
+ * @brief Stages the next frame in internal SRAM while the current one is shown
+ * @details Frames that live in PSRAM are copied into a small internal buffer during
+ * the idle time after show(), so composing them does not stall on the PSRAM cache.
+ * Frames already in internal RAM, or larger than PREFETCH_MAX_PIXELS, are used in
+ * place. Owned and used by the render task only.
+ */
+struct FrameStager {
+private:
+    Pixel* buffer_ = nullptr;           // Internal SRAM staging buffer
+    size_t capacity_ = 0;               // Pixels the buffer holds
+    const Frame* source_ = nullptr;     // Frame that is staged or being staged
+    std::weak_ptr<const Animation> owner_;  // Animation source_ belongs to
+    size_t count_ = 0;                  // Pixels in the staged frame
+    size_t asyncBytes_ = 0;             // Leading bytes copied by DMA, the rest is copied in take()
+    volatile bool inFlight_ = false;    // An async copy has not completed yet
+
+#ifdef PREFETCH_ASYNC_MEMCPY
+    async_memcpy_handle_t dma_ = nullptr;
+    SemaphoreHandle_t done_ = nullptr;
+
+    static bool IRAM_ATTR onCopyDone(async_memcpy_handle_t handle, async_memcpy_event_t* event, void* args);
+
+    /**
+     * @brief Install the async memcpy driver
+     */
+    void installDma();
+#endif
+
+    /**
+     * @brief Wait for a pending async copy
+     * @return True if the copy completed, false if it timed out and was abandoned
+     * @details A copy that times out is stopped by reinstalling the DMA driver, so the
+     * buffer is free again either way. Only its staged frame is dropped.
+     */
+    bool waitForCopy();
+
+public:
+    FrameStager() = default;
+    FrameStager(const FrameStager&) = delete;
+    FrameStager& operator=(const FrameStager&) = delete;
+
+    ~FrameStager() {
+        end();
+    }
+
+    /**
+     * @brief Allocate the internal staging buffer for an animation
+     * @param maxPixels The largest frame to stage, capped at PREFETCH_MAX_PIXELS
+     * @param animation The animation about to be played
+     * @return True if staging is available, false if frames are always used in place
+     * @details A frame staged for another animation is dropped. One staged for the same
+     * animation, e.g. its first frame prefetched at the end of the previous loop, is kept.
+     * After sealHeap() the buffer no longer grows, size it for the largest frame before.
+     */
+    bool begin(size_t maxPixels, const std::shared_ptr<const Animation>& animation);
+
+    /**
+     * @brief Release the staging buffer and the DMA channel
+     */
+    void end();
+
+    /**
+     * @brief Start staging a frame
+     * @param frame The frame the next take() will ask for. Must stay alive until then.
+     */
+    void prefetch(const Frame& frame);
+
+    /**
+     * @brief Get the pixel data to compose a frame from
+     * @param frame The frame to compose
+     * @param count Set to the number of pixels
+     * @return The staged copy if this frame was prefetched, otherwise the frame's own data
+     */
+    const Pixel* take(const Frame& frame, size_t& count);
+};
+
+#endif
@@ -0,0 +1,131 @@
+#include "registry.h"
+
+
+size_t AnimationRegistry::find(AnimationId id) const {
+    size_t slot = home(id);
+    for (size_t probes = 0; probes < CAPACITY; probes++) {
+        const Entry& entry = entries_[slot];
+        if (!entry.used) return CAPACITY;
+        if (entry.id == id) return slot;
+        slot = (slot + 1) & (CAPACITY - 1);
+    }
+    return CAPACITY;
+}
+
+
+bool AnimationRegistry::insert(const std::string& name, const std::string& path, std::shared_ptr<const Animation> animation) {
+    const AnimationId id = hashAnimationName(name.data(), name.length());
+    size_t slot = find(id);
+
+    if (slot != CAPACITY) {
+        Entry& entry = entries_[slot];
+        if (entry.name != name) {
+            debugf("Animation id collision: '%s' and '%s' both hash to %lu\n", name.c_str(), entry.name.c_str(), (unsigned long)id);
+            return false;
+        }
+        entry.path = path;
+        entry.animation = std::move(animation);
+        debugf("Animation '%s' replaced in registry\n", name.c_str());
+        return true;
+    }
+
+    if (size_ >= MAX_ENTRIES) {
+        debugf("Animation registry full, '%s' not added\n", name.c_str());
+        return false;
+    }
+
+    slot = home(id);
+    while (entries_[slot].used) slot = (slot + 1) & (CAPACITY - 1);
+
+    Entry& entry = entries_[slot];
+    entry.used = true;
+    entry.id = id;
+    entry.name = name;
+    entry.path = path;
+    entry.animation = std::move(animation);
+    size_++;
+    debugf("Animation '%s' registered as %lu\n", name.c_str(), (unsigned long)id);
+    return true;
+}
+
+
+bool AnimationRegistry::add(std::shared_ptr<const Animation> animation) {
+    if (!animation) return false;
+    std::lock_guard<std::mutex> lock(mutex_);
+    const std::string name = animation->getName();
+    return insert(name, "", std::move(animation));
+}
+
+
+bool AnimationRegistry::addFile(const std::string& name, const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return insert(name, path, nullptr);
+}
+
+
+std::shared_ptr<const Animation> AnimationRegistry::get(AnimationId id) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const size_t slot = find(id);
+    if (slot == CAPACITY) return nullptr;
+    return entries_[slot].animation;
+}
+
+
+std::shared_ptr<const Animation> AnimationRegistry::acquire(AnimationId id, fs::FS& fs) {
+    std::string path;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const size_t slot = find(id);
+        if (slot == CAPACITY) return nullptr;
+        if (entries_[slot].animation || entries_[slot].path.empty()) return entries_[slot].animation;
+        path = entries_[slot].path;
+    }
+
+    // Load without holding the lock, lookups of other animations stay fast meanwhile
+    Animation loaded = loadAnimation(fs, path);
+    if (loaded.frameCount() == 0) return nullptr;
+    auto animation = std::make_shared<const Animation>(std::move(loaded));
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    const size_t slot = find(id);
+    if (slot == CAPACITY) return animation;
+    if (!entries_[slot].animation) entries_[slot].animation = animation;
+    return entries_[slot].animation;
+}
+
+
+void AnimationRegistry::release(AnimationId id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const size_t slot = find(id);
+    if (slot != CAPACITY && !entries_[slot].path.empty()) entries_[slot].animation.reset();
+}
+
+
+bool AnimationRegistry::remove(AnimationId id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t hole = find(id);
+    if (hole == CAPACITY) return false;
+
+    // Backward-shift deletion keeps every remaining entry reachable from its home slot
+    size_t next = hole;
+    while (true) {
+        next = (next + 1) & (CAPACITY - 1);
+        if (!entries_[next].used) break;
+        const size_t want = home(entries_[next].id);
+        const bool movable = hole <= next ? (want <= hole || want > next) : (want <= hole && want > next);
+        if (movable) {
+            entries_[hole] = std::move(entries_[next]);
+            hole = next;
+        }
+    }
+
+    entries_[hole] = Entry();
+    size_--;
+    return true;
+}
+
+
+bool AnimationRegistry::contains(AnimationId id) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return find(id) != CAPACITY;
+}
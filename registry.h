@@ -0,0 +1,126 @@
+#pragma once
+#ifndef REGISTRY_H
+#define REGISTRY_H
+
+#include "animation.h"
+
+
+/**
+ * @brief Fixed-capacity table from animation ids to loaded or loadable animations
+ * @details Open addressing with linear probing, so a lookup is a hash and a few
+ * compares. Entries hold either a resident animation or the path it is loaded
+ * from on first use. Registering a different name under an id that is already
+ * taken is refused, so two names can never silently share an id.
+ *
+ * Switching animations is then a lookup plus a pointer swap:
+ *   renderer.setAnimation(registry.get("blink"_anim));
+ */
+struct AnimationRegistry {
+public:
+    static constexpr size_t CAPACITY = 64;                  // Must be a power of two
+    static constexpr size_t MAX_ENTRIES = CAPACITY * 3 / 4; // Keep probe chains short
+
+private:
+    struct Entry {
+        bool used = false;
+        AnimationId id = 0;
+        std::string name;
+        std::string path;                               // Empty for animations added in memory
+        std::shared_ptr<const Animation> animation;     // Null until a file-backed entry is loaded
+    };
+
+    std::array<Entry, CAPACITY> entries_;
+    size_t size_ = 0;
+    mutable std::mutex mutex_;
+
+    /**
+     * @brief Home slot of an id
+     */
+    static size_t home(AnimationId id) {
+        return (id * 2654435761u) & (CAPACITY - 1);
+    }
+
+    /**
+     * @brief Find the slot holding an id
+     * @return The slot, or CAPACITY if the id is not registered
+     * @details Must be called with the mutex held.
+     */
+    size_t find(AnimationId id) const;
+
+    /**
+     * @brief Insert or replace an entry
+     * @details Must be called with the mutex held.
+     */
+    bool insert(const std::string& name, const std::string& path, std::shared_ptr<const Animation> animation);
+
+public:
+    AnimationRegistry() = default;
+    AnimationRegistry(const AnimationRegistry&) = delete;
+    AnimationRegistry& operator=(const AnimationRegistry&) = delete;
+
+    /**
+     * @brief Register a resident animation under the hash of its name
+     * @param animation The animation, ideally frozen
+     * @return True if registered, false on an id collision or a full registry
+     */
+    bool add(std::shared_ptr<const Animation> animation);
+
+    /**
+     * @brief Register a resident animation, taking ownership of it
+     * @param animation The animation to move in
+     * @return True if registered, false on an id collision or a full registry
+     */
+    bool add(Animation&& animation) {
+        return add(shareAnimation(std::move(animation)));
+    }
+
+    /**
+     * @brief Register an animation that is loaded from a file on first use
+     * @param name The animation name the id is derived from
+     * @param path The path of the animation file
+     * @return True if registered, false on an id collision or a full registry
+     */
+    bool addFile(const std::string& name, const std::string& path);
+
+    /**
+     * @brief Look up a resident animation
+     * @param id The animation id, e.g. "blink"_anim
+     * @return The animation, or nullptr if unknown or not loaded yet
+     */
+    std::shared_ptr<const Animation> get(AnimationId id) const;
+
+    /**
+     * @brief Look up an animation, loading it from its file if needed
+     * @param id The animation id
+     * @param fs The file system file-backed entries are read from
+     * @return The animation, or nullptr if unknown or loading failed
+     */
+    std::shared_ptr<const Animation> acquire(AnimationId id, fs::FS& fs);
+
+    /**
+     * @brief Drop the resident copy of a file-backed animation
+     * @details The renderer keeps its own reference, so this is safe while it plays.
+     */
+    void release(AnimationId id);
+
+    /**
+     * @brief Remove an animation from the registry
+     * @return True if it was registered
+     */
+    bool remove(AnimationId id);
+
+    /**
+     * @brief Checks if an id is registered
+     */
+    bool contains(AnimationId id) const;
+
+    /**
+     * @brief Get the number of registered animations
+     */
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return size_;
+    }
+};
+
+#endif
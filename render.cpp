@@ -1,5 +1,54 @@
 #include "render.h"
 
+/**
+ * Find the frame shown at a point on the animation timeline.
+ * @param clockMs The animation clock in milliseconds
+ * @param animation The animation, frozen
+ * @param frameCount The number of frames that can be shown
+ * @param state The render settings
+ * @param cursor The frame found by the previous call, speeds up timeline lookups
+ * @param untilNextMs Set to the milliseconds until the frame changes
+ * @param finished Set if a non-repeating animation has played to its end
+ * @return The index of the frame to show
+ * @details A repeating animation cycles through its frames followed by the repeat delay.
+ * Frames are spaced by the frame delay, or placed by their own timestamps if the
+ * animation has a timeline.
+ */
+static size_t frameAtTime(
+    uint32_t clockMs,
+    const Animation& animation,
+    size_t frameCount,
+    const RenderState& state,
+    size_t& cursor,
+    unsigned long& untilNextMs,
+    bool& finished
+) {
+    const bool timeline = animation.hasTimeline();
+    const uint64_t frameMs = std::max<uint16_t>(state.frameDelayMs, 1);
+    const uint64_t playMs = timeline ? animation.timelineDurationMs() : frameMs * frameCount;
+    const uint64_t cycleMs = playMs + state.repeatDelayMs;
+    uint64_t position = static_cast<uint64_t>(clockMs * static_cast<double>(state.speedCoefficient));
+
+    finished = !state.repeat && position >= playMs;
+    if (state.repeat && cycleMs > 0) position %= cycleMs;
+
+    size_t index;
+    uint64_t remaining;
+    if (position >= playMs) {
+        index = frameCount - 1;
+        remaining = state.repeat ? cycleMs - position : frameMs;
+    } else if (timeline) {
+        index = animation.frameAtMs(static_cast<uint32_t>(position), cursor);
+        remaining = animation.frameEndMs(index) - position;
+    } else {
+        index = position / frameMs;
+        remaining = frameMs - position % frameMs;
+    }
+
+    untilNextMs = std::max<unsigned long>(1, static_cast<unsigned long>(remaining / state.speedCoefficient));
+    return index;
+}
+
 RenderState render(Renderer& rend) {
 
     if (!rend.isRunning()) {
@@ -9,6 +58,10 @@ RenderState render(Renderer& rend) {
 
     debugln(">> Animation is still running");
 
+    if (rend.hasSegments()) return renderSegments(rend);
+    if (rend.getFrameTrigger() != nullptr) return renderTriggered(rend);
+    if (rend.isClockSynced() || rend.getCurrentAnimation()->hasTimeline()) return renderSynced(rend);
+
     // Check if the current animation is empty
     if (rend.isAnimationEmpty()) {
         debugln(">> Current animation is empty, stopping render");
@@ -24,8 +77,9 @@ RenderState render(Renderer& rend) {
 
     debugln(">>Got the current render state");
 
-    // Get a reference to the frames in the current animation
-    const FrameBuffer& frames = rend.getCurrentAnimationFrames();
+    // Hold the current animation so its frames stay alive even if it is swapped out
+    std::shared_ptr<const Animation> animation = rend.getCurrentAnimation();
+    const FrameBuffer& frames = animation->getFrames();
     size_t frameCount = frames.size();
     if (frameCount == 0) {
         debugln(">> No frames in the animation, stopping render");
@@ -34,9 +88,21 @@ RenderState render(Renderer& rend) {
 
     debugln(">> Retrieved frame buffer");
 
+    // Stage frames from PSRAM into internal SRAM during the idle time between frames.
+    // Frames a progressive load has not published yet are unknown, so size for the largest allowed.
+    FrameStager& stager = rend.frameStager();
+    size_t largestFrame = 0;
+    if (animation->isLoading()) largestFrame = PREFETCH_MAX_PIXELS;
+    else for (const Frame& frame : frames) largestFrame = std::max(largestFrame, frame.size());
+    stager.begin(largestFrame, animation);
+
     size_t frameSize = frames[0].size();
     debugln(">> Starting render loop");
 
+    // Frames are due on a fixed wall-clock schedule, so time spent composing and showing
+    // comes out of the delay instead of slowing playback down
+    int64_t dueUs = esp_timer_get_time();
+
     for (size_t frameindex = 0; frameindex < frameCount && state.isRunning; frameindex++) {
 
         if (state.currentAnimationHash != previousNameHash) {
@@ -49,27 +115,316 @@ RenderState render(Renderer& rend) {
             return rend.outputState();
         }
 
+        // Hold the last frame while a progressive load has not published this one yet
+        bool stalled = false;
+        while (frameindex >= animation->readyFrameCount() && animation->isLoading()) {
+            stalled = true;
+            if (rend.interruptableDelay(PROGRESSIVE_STALL_MS)) {
+                debugln(">> Render interrupted, stopping");
+                rend.setEarlyExit(false);
+                return rend.outputState();
+            }
+        }
+        if (stalled) dueUs = esp_timer_get_time();
+
+        // A load that failed part way ends at its last published frame
+        if (frameindex >= animation->readyFrameCount()) break;
+
         const Frame& frame = frames[frameindex];
         frameSize = frame.size();
 
-        rend.writeFrameToScreen(frame);
+        const int64_t startUs = esp_timer_get_time();
+        size_t pixelCount = 0;
+        const Pixel* pixels = stager.take(frame, pixelCount);
+        rend.writeFrameToScreen(pixels, pixelCount, animation->getFrameBounds(frameindex));
+        const int64_t shownUs = esp_timer_get_time();
+        rend.events().postFrame(frameindex, state.currentAnimationHash);
 
-        if (rend.interruptableDelay((unsigned long)(state.frameDelayMs / state.speedCoefficient))) {
+        // Overrun by whole frames: draw them into the buffer unseen to get back on schedule
+        const int64_t periodUs = std::max<int64_t>(1, static_cast<int64_t>(state.frameDelayMs * 1000.0f / state.speedCoefficient));
+        dueUs += periodUs;
+        uint32_t skipped = 0;
+        while (shownUs - dueUs >= periodUs && frameindex + 1 < animation->readyFrameCount()) {
+            frameindex++;
+            dueUs += periodUs;
+            skipped++;
+            rend.composeFrame(frames[frameindex].data(), frames[frameindex].size(), animation->getFrameBounds(frameindex));
+            rend.events().postFrame(frameindex, state.currentAnimationHash);
+        }
+        rend.recordFrame(static_cast<uint32_t>(shownUs - startUs), static_cast<uint32_t>(periodUs), skipped);
+
+        if (frameindex + 1 < animation->readyFrameCount()) stager.prefetch(frames[frameindex + 1]);
+        else if (frameindex + 1 >= frameCount && state.repeat) stager.prefetch(frames[0]);
+
+        const int64_t waitUs = dueUs - esp_timer_get_time();
+        if (rend.interruptableDelay(waitUs > 0 ? static_cast<unsigned long>(waitUs / 1000) : 0)) {
             debugln(">> Render interrupted, stopping");
             rend.setEarlyExit(false);
             return rend.outputState();
         }
 
-        if (!state.repeat) {
+        previousNameHash = state.currentAnimationHash;
+        rend.updateEnvelopes(millis());
+        rend.outputState(state);
+    }
+
+    // If we reach here, the animation played to its last frame or was stopped
+    if (!state.isRunning) return state;
+    if (!state.repeat) {
+        rend.setRunning(false);
+        rend.events().post({RenderEventType::AnimationFinished, 0, state.currentAnimationHash});
+        debugln(">> Animation finished, stopping render");
+        return rend.outputState();
+    }
+    rend.events().postLoop(state.currentAnimationHash);
+    return state;
+}
+
+
+RenderState renderSegments(Renderer& rend) {
+    debugln(">> Rendering segments");
+
+    while (rend.isRunning() && rend.hasSegments()) {
+        rend.updateEnvelopes(millis());
+        unsigned long untilNext = rend.composeSegments(millis());
+
+        if (rend.interruptableDelay(untilNext)) {
+            debugln(">> Segment render interrupted, stopping");
+            rend.setEarlyExit(false);
+            break;
+        }
+    }
+
+    return rend.outputState();
+}
+
+
+RenderState renderSynced(Renderer& rend) {
+    // Without an external source, timeline animations play against the time since they started
+    const bool external = rend.isClockSynced();
+    const uint32_t startMs = millis();
+    debugln(external ? ">> Rendering against the external clock" : ">> Rendering the animation timeline");
+
+    RenderState state = rend.outputState();
+    const uint32_t animationHash = state.currentAnimationHash;
+    size_t shownIndex = SIZE_MAX;
+    size_t cursor = 0;
+
+    std::shared_ptr<const Animation> animation = rend.getCurrentAnimation();
+    const FrameBuffer& frames = animation->getFrames();
+
+    FrameStager& stager = rend.frameStager();
+    size_t largestFrame = 0;
+    if (animation->isLoading()) largestFrame = PREFETCH_MAX_PIXELS;
+    else for (const Frame& frame : frames) largestFrame = std::max(largestFrame, frame.size());
+    stager.begin(largestFrame, animation);
+
+    while (state.isRunning && state.currentAnimationHash == animationHash && rend.isClockSynced() == external) {
+        if (frames.empty()) break;
+
+        // While loading the timeline keeps its full length, so unpublished frames are held rather than skipped
+        const bool loading = animation->isLoading();
+        const size_t ready = animation->readyFrameCount();
+        if (ready == 0) break;
+
+        unsigned long untilNextMs = 0;
+        bool finished = false;
+        const uint32_t clockMs = external ? rend.syncClock() : millis() - startMs;
+        const size_t frameindex = frameAtTime(clockMs, *animation, loading ? frames.size() : ready, state, cursor, untilNextMs, finished);
+
+        if (finished) {
             rend.setRunning(false);
+            rend.events().post({RenderEventType::AnimationFinished, 0, animationHash});
             debugln(">> Animation finished, stopping render");
-            return rend.outputState();
+            break;
         }
 
-        previousNameHash = state.currentAnimationHash;
-        state = rend.outputState();
+        if (frameindex >= ready) untilNextMs = PROGRESSIVE_STALL_MS;
+
+        // Only write when the clock moved onto another frame, then stage the one after it
+        if (frameindex != shownIndex && frameindex < ready) {
+            // Frames the clock jumped over are drawn unseen, the frames build on each other
+            uint32_t skipped = 0;
+            if (shownIndex != SIZE_MAX) {
+                for (size_t i = (shownIndex + 1) % ready; i != frameindex && skipped + 1 < ready; i = (i + 1) % ready, skipped++) {
+                    rend.composeFrame(frames[i].data(), frames[i].size(), animation->getFrameBounds(i));
+                    rend.events().postFrame(i, animationHash);
+                }
+                if (frameindex < shownIndex) rend.events().postLoop(animationHash);
+            }
+
+            const int64_t startUs = esp_timer_get_time();
+            size_t pixelCount = 0;
+            const Pixel* pixels = stager.take(frames[frameindex], pixelCount);
+            rend.writeFrameToScreen(pixels, pixelCount, animation->getFrameBounds(frameindex));
+            rend.recordFrame(static_cast<uint32_t>(esp_timer_get_time() - startUs), 0, skipped);
+            rend.events().postFrame(frameindex, animationHash);
+            const size_t nextIndex = (frameindex + 1) % frames.size();
+            if (nextIndex < ready) stager.prefetch(frames[nextIndex]);
+            shownIndex = frameindex;
+        }
+
+        if (rend.interruptableDelay(untilNextMs)) {
+            debugln(">> Render interrupted, stopping");
+            rend.setEarlyExit(false);
+            break;
+        }
+
+        rend.updateEnvelopes(millis());
+        rend.outputState(state);
     }
 
-    // If we reach here, the animation has finished or was interrupted
-    return state;
-}
\ No newline at end of file
+    return rend.outputState();
+}
+
+/**
+ * Show a run of steps of a triggered animation.
+ * @param rend The renderer to use
+ * @param animation The animation
+ * @param stager The frame stager
+ * @param next The first step not shown yet, advanced past last
+ * @param last The step to show, the ones before it are drawn unseen
+ * @param frameCount The length of the animation, in full even while it loads
+ * @param ready The frames published so far, every step up to last must be one of them
+ * @param hash The name hash of the animation, for the events
+ * @details Step s shows frame s % frameCount.
+ */
+static void showSteps(
+    Renderer& rend,
+    const Animation& animation,
+    FrameStager& stager,
+    uint32_t& next,
+    uint32_t last,
+    size_t frameCount,
+    size_t ready,
+    uint32_t hash
+) {
+    const FrameBuffer& frames = animation.getFrames();
+    const int64_t startUs = esp_timer_get_time();
+    uint32_t skipped = 0;
+
+    // Every LED ends on its last write within a cycle, so drawing more than one cycle changes nothing
+    if (last - next >= frameCount) next = last - frameCount + 1;
+
+    for (; next <= last; next++) {
+        const size_t index = next % frameCount;
+        if (index == 0 && next > 0) rend.events().postLoop(hash);
+
+        if (next < last) {
+            rend.composeFrame(frames[index].data(), frames[index].size(), animation.getFrameBounds(index));
+            skipped++;
+        } else {
+            size_t pixelCount = 0;
+            const Pixel* pixels = stager.take(frames[index], pixelCount);
+            rend.writeFrameToScreen(pixels, pixelCount, animation.getFrameBounds(index));
+            const size_t nextIndex = (index + 1) % frameCount;
+            if (nextIndex < ready) stager.prefetch(frames[nextIndex]);
+        }
+        rend.events().postFrame(index, hash);
+    }
+
+    rend.recordFrame(static_cast<uint32_t>(esp_timer_get_time() - startUs), 0, skipped);
+}
+
+
+RenderState renderTriggered(Renderer& rend) {
+    FrameTrigger* trigger = rend.getFrameTrigger();
+    const TriggerMode mode = rend.getTriggerMode();
+    const uint32_t framesPerBeat = rend.getFramesPerBeat();
+    debugln(mode == TriggerMode::Step ? ">> Rendering a frame per trigger" : ">> Rendering frames on the beat");
+
+    RenderState state = rend.outputState();
+    const uint32_t animationHash = state.currentAnimationHash;
+
+    std::shared_ptr<const Animation> animation = rend.getCurrentAnimation();
+    const FrameBuffer& frames = animation->getFrames();
+
+    FrameStager& stager = rend.frameStager();
+    size_t largestFrame = 0;
+    if (animation->isLoading()) largestFrame = PREFETCH_MAX_PIXELS;
+    else for (const Frame& frame : frames) largestFrame = std::max(largestFrame, frame.size());
+    stager.begin(largestFrame, animation);
+
+    uint32_t next = 0;              // First step not shown yet
+    uint32_t end = 0;               // One past the last step asked for, steps [next, end) are owed
+    uint32_t beatStep = 0;          // Step the last beat landed on
+    bool started = false;           // The first trigger arrived
+    int64_t dueUs = 0;              // When the next frame between beats is due
+    trigger->bind();
+
+    while (state.isRunning && state.currentAnimationHash == animationHash &&
+           rend.getFrameTrigger() == trigger && rend.getTriggerMode() == mode) {
+        // Loading is read first: once it reads false, every frame is published
+        const bool loading = animation->isLoading();
+        const size_t ready = animation->readyFrameCount();
+        if (frames.empty() || ready == 0) break;
+
+        const uint32_t triggers = trigger->take();
+        const int64_t nowUs = esp_timer_get_time();
+        const int64_t frameUs = std::max<int64_t>(trigger->beatPeriodUs() / framesPerBeat, 1);
+        const bool betweenBeats = started && mode == TriggerMode::Tempo && trigger->beatPeriodUs() > 0 && next < beatStep + framesPerBeat;
+
+        if (triggers > 0 && mode == TriggerMode::Step) {
+            end = std::max(end, next) + triggers;
+        } else if (triggers > 0) {
+            // The beat lands on its frame, frames still due before it are drawn unseen
+            beatStep = started ? beatStep + triggers * framesPerBeat : (triggers - 1) * framesPerBeat;
+            end = std::max(end, beatStep + 1);
+            dueUs = nowUs + frameUs;
+        } else if (betweenBeats && nowUs >= dueUs) {
+            end = std::max(end, next + 1);
+            dueUs += frameUs;
+        }
+        started = started || triggers > 0;
+
+        bool stalled = false;
+        if (end > next) {
+            // While loading the animation keeps its full length, like in renderSynced()
+            const size_t length = loading ? frames.size() : ready;
+            uint32_t last = end - 1;
+
+            // A non-repeating animation ends on its last frame
+            bool finished = !state.repeat && last >= length - 1;
+            if (finished) last = length - 1;
+
+            // Steps onto frames the loader has not published yet wait for them, the rest stay owed
+            if (loading) {
+                const uint32_t blocked = next % length >= ready ? next : next + static_cast<uint32_t>(ready - next % length);
+                if (last >= blocked) {
+                    last = blocked - 1;
+                    stalled = true;
+                    finished = false;
+                }
+            }
+            if (last >= next) showSteps(rend, *animation, stager, next, last, length, ready, animationHash);
+
+            if (finished) {
+                rend.setRunning(false);
+                rend.events().post({RenderEventType::AnimationFinished, 0, animationHash});
+                debugln(">> Animation finished, stopping render");
+                break;
+            }
+        }
+
+        // Sleep until a trigger, the next frame between beats, or the next check for stop
+        TickType_t waitTicks = pdMS_TO_TICKS(TRIGGER_POLL_MS);
+        if (started && mode == TriggerMode::Tempo && trigger->beatPeriodUs() > 0 && next < beatStep + framesPerBeat) {
+            const int64_t untilDueUs = std::max<int64_t>(dueUs - esp_timer_get_time(), 0);
+            waitTicks = std::min<TickType_t>(waitTicks, pdMS_TO_TICKS((untilDueUs + 999) / 1000));
+        }
+        if (stalled) waitTicks = std::min<TickType_t>(waitTicks, pdMS_TO_TICKS(PROGRESSIVE_STALL_MS));
+        trigger->wait(waitTicks);
+
+        if (rend.getEarlyExit()) {
+            debugln(">> Render interrupted, stopping");
+            rend.setEarlyExit(false);
+            break;
+        }
+
+        rend.updateEnvelopes(millis());
+        rend.outputState(state);
+    }
+
+    trigger->unbind();
+    return rend.outputState();
+}
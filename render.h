@@ -2,9 +2,44 @@
 #define RENDER_H
 
 #include "io.h"
-#include <Adafruit_NeoPixel.h>
+#include "strip.h"
 #include "animation.h"
+#include "segment.h"
+#include "clock.h"
+#include "budget.h"
+#include "prefetch.h"
+#include "envelope.h"
+#include "heapguard.h"
+#include "corehelper.h"
+#include "events.h"
+#include "trigger.h"
 #include <math.h>
+#include <string.h>
+
+// Milliseconds to hold the current frame when playback catches up with a progressive load
+#define PROGRESSIVE_STALL_MS 5
+
+// Smallest frame, in pixels, that parallel compose splits across both cores
+#define PARALLEL_COMPOSE_MIN_PIXELS 2048
+
+// Pixels per chunk of a parallel compose
+#define PARALLEL_COMPOSE_CHUNK 256
+
+// Characters of the animation name a RenderState keeps, longer names are cut off
+#define RENDER_STATE_NAME_CHARS 32
+
+
+/**
+ * @brief Counters of how well playback keeps up with the wall clock
+ */
+struct PlaybackTelemetry {
+    uint32_t framesShown = 0;       // Frames sent to the strip
+    uint32_t framesSkipped = 0;     // Frames folded into the buffer but never shown, to catch up
+    uint32_t overruns = 0;          // Frames whose compose and show took longer than the frame period
+    uint32_t lastFrameUs = 0;       // Compose and show time of the last frame
+    uint32_t maxFrameUs = 0;        // Longest compose and show time
+    uint32_t helperChunks = 0;      // Compose chunks done by the helper on the other core
+};
 
 
 struct RenderState{
@@ -17,7 +52,7 @@ struct RenderState{
     uint16_t repeatDelayMs = 50;            // Delay before repeating the animation in milliseconds
     float speedCoefficient = 1.0f;          // Speed coefficient for animation playback
     float peakBrightnessCoefficient = 0.40f;// Peak brightness coefficient for LED colors
-    std::string currentAnimationName = "NONE";   // Name of the current animation
+    char currentAnimationName[RENDER_STATE_NAME_CHARS + 1] = "NONE";  // Name of the current animation, fixed size so copies never allocate
     uint32_t currentAnimationHash = 0;      // Hash of current animation name for fast comparison
 
     RenderState(
@@ -30,7 +65,7 @@ struct RenderState{
         uint16_t repeatDelayMs = 50,
         float speedCoefficient = 1.0f,
         float peakBrightnessCoefficient = 0.40f,
-        std::string currentAnimationName = "NONE",
+        const char* currentAnimationName = "NONE",
         uint32_t currentAnimationHash = 0
     ):
         exitEarly(exitEarly),
@@ -42,9 +77,18 @@ struct RenderState{
         repeatDelayMs(repeatDelayMs),
         speedCoefficient(speedCoefficient),
         peakBrightnessCoefficient(peakBrightnessCoefficient),
-        currentAnimationName(currentAnimationName),
         currentAnimationHash(currentAnimationHash)
-    {}
+    {
+        setAnimationName(currentAnimationName);
+    }
+
+    /**
+     * @brief Copy a name in, cut off at RENDER_STATE_NAME_CHARS
+     */
+    void setAnimationName(const char* name) {
+        strncpy(currentAnimationName, name, RENDER_STATE_NAME_CHARS);
+        currentAnimationName[RENDER_STATE_NAME_CHARS] = '\0';
+    }
 
 
     RenderState(const RenderState& other) {
@@ -57,7 +101,7 @@ struct RenderState{
         repeatDelayMs = other.repeatDelayMs;
         speedCoefficient = other.speedCoefficient;
         peakBrightnessCoefficient = other.peakBrightnessCoefficient;
-        currentAnimationName = other.currentAnimationName;
+        memcpy(currentAnimationName, other.currentAnimationName, sizeof(currentAnimationName));
         currentAnimationHash = other.currentAnimationHash;
     }
 
@@ -73,7 +117,7 @@ struct RenderState{
         repeatDelayMs = other.repeatDelayMs;
         speedCoefficient = other.speedCoefficient;
         peakBrightnessCoefficient = other.peakBrightnessCoefficient;
-        currentAnimationName = other.currentAnimationName;
+        memcpy(currentAnimationName, other.currentAnimationName, sizeof(currentAnimationName));
         currentAnimationHash = other.currentAnimationHash;
 
         return *this;
@@ -96,9 +140,140 @@ private:
     uint16_t repeatDelayMs;
     float speedCoefficient;
     float peakBrightnessCoefficient;
+    float gamma_ = 1.0f;
+    uint16_t gammaLut_[256];                // Gamma curve in 8.8 fixed point, indexed by channel value
+    uint8_t outputLut_[3][256];             // Per-channel brightness, gamma and white balance, indexed by channel value
+    uint32_t whiteBalanceQ16_[3] = {65536, 65536, 65536};  // Per-channel gain in Q16.16, at most 1.0
+    Envelope brightnessEnvelope_;           // Brightness transition evaluated by the render task
+    Envelope speedEnvelope_;                // Speed transition evaluated by the render task
     mutable std::mutex mutex_;
-    Adafruit_NeoPixel screen;
-    Animation currentAnimation;
+    OutputStrip screen;                     // Output buffer, allocated once for the maximum length
+    std::shared_ptr<const Animation> currentAnimation = std::make_shared<const Animation>();
+    std::vector<Segment> segments_;
+    PlaybackClock clock_;
+    TimecodeSource* timecode_ = nullptr;
+    FrameTrigger* trigger_ = nullptr;
+    TriggerMode triggerMode_ = TriggerMode::Step;
+    uint16_t framesPerBeat_ = 4;
+    FrameStager stager_;
+    PlaybackTelemetry telemetry_;
+    bool pendingShow_ = false;              // Skipped frames changed the buffer since the last show()
+    RenderEvents events_;                   // Posted by the render task, dispatched on the app task
+    CoreHelper helper_;                     // Composes part of large frames on the other core
+    bool parallelCompose_ = false;
+
+    /**
+     * @brief A frame being composed in chunks
+     */
+    struct ComposeJob {
+        Renderer* renderer;
+        const Pixel* pixels;
+        size_t count;
+        uint8_t* out;
+    } composeJob_;
+
+    // Byte order of NEO_GRB in the output buffer
+    static constexpr uint8_t R_OFFSET = 1;
+    static constexpr uint8_t G_OFFSET = 0;
+    static constexpr uint8_t B_OFFSET = 2;
+
+    /**
+     * @brief Rebuild the gamma curve after a gamma change, then the output tables
+     * @details Must be called with the mutex held.
+     */
+    void rebuildGammaLut() {
+        for (int v = 0; v < 256; v++) {
+            const float level = gamma_ == 1.0f ? v : 255.0f * powf(v / 255.0f, gamma_);
+            gammaLut_[v] = static_cast<uint16_t>(level * 256.0f + 0.5f);
+        }
+        rebuildOutputLut();
+    }
+
+    /**
+     * @brief Rebuild the output lookup tables after a brightness or white balance change
+     * @details Must be called with the mutex held. Integer only, cheap enough to run
+     * every frame of a brightness envelope.
+     */
+    void rebuildOutputLut() {
+        const uint32_t brightness = static_cast<uint32_t>(toQ16(peakBrightnessCoefficient));
+        for (int c = 0; c < 3; c++) {
+            const uint32_t scale = static_cast<uint32_t>((static_cast<uint64_t>(brightness) * whiteBalanceQ16_[c]) >> 16);
+            for (int v = 0; v < 256; v++) {
+                outputLut_[c][v] = static_cast<uint8_t>((gammaLut_[v] * scale + (1u << 23)) >> 24);
+            }
+        }
+    }
+
+    /**
+     * @brief Draw a frame with known bounds into the output buffer
+     * @return False if the frame touches no LED of the strip and nothing was written
+     * @details Must be called with the mutex held. Sorted frames, which is every frame
+     * the loaders produce, and frames entirely on the strip are written without
+     * per-pixel range checks.
+     */
+    bool composeFrameLocked(const Pixel* pixels, size_t count, const FrameBounds& bounds) {
+        if (!bounds.touches(0, ledCount)) return false;
+
+        uint8_t* out = screen.getPixels();
+        if (!bounds.sorted && !bounds.within(ledCount)) {
+            for (size_t i = 0; i < count; i++) {
+                const Pixel& pixel = pixels[i];
+                if (pixel.index >= ledCount) continue;
+                storePixel(out, pixel.index, outputLut_[0][pixel.r], outputLut_[1][pixel.g], outputLut_[2][pixel.b]);
+            }
+            return true;
+        }
+
+        // Sorted, the pixels beyond the strip are a tail to cut off
+        if (!bounds.within(ledCount)) {
+            count = std::lower_bound(pixels, pixels + count, ledCount,
+                [](const Pixel& pixel, uint16_t end) { return pixel.index < end; }) - pixels;
+        }
+
+        if (parallelCompose_ && bounds.sorted && count >= PARALLEL_COMPOSE_MIN_PIXELS) {
+            composeJob_ = {this, pixels, count, out};
+            helper_.run(composeChunk, &composeJob_, (count + PARALLEL_COMPOSE_CHUNK - 1) / PARALLEL_COMPOSE_CHUNK);
+            return true;
+        }
+
+        for (size_t i = 0; i < count; i++) {
+            const Pixel& pixel = pixels[i];
+            storePixel(out, pixel.index, outputLut_[0][pixel.r], outputLut_[1][pixel.g], outputLut_[2][pixel.b]);
+        }
+        return true;
+    }
+
+    /**
+     * @brief Compose one chunk of a ComposeJob, on either core
+     * @details The chunk edges move past repeated indices, so every LED is written by
+     * one chunk only and the last write of a repeated index still wins.
+     */
+    static void composeChunk(void* context, size_t chunk) {
+        const ComposeJob& job = *static_cast<const ComposeJob*>(context);
+        const auto edge = [&job](size_t i) {
+            i = std::min(i, job.count);
+            while (i > 0 && i < job.count && job.pixels[i].index == job.pixels[i - 1].index) i++;
+            return i;
+        };
+
+        const size_t end = edge((chunk + 1) * PARALLEL_COMPOSE_CHUNK);
+        const uint8_t (&lut)[3][256] = job.renderer->outputLut_;
+        for (size_t i = edge(chunk * PARALLEL_COMPOSE_CHUNK); i < end; i++) {
+            const Pixel& pixel = job.pixels[i];
+            job.renderer->storePixel(job.out, pixel.index, lut[0][pixel.r], lut[1][pixel.g], lut[2][pixel.b]);
+        }
+    }
+
+    /**
+     * @brief Write one color into the output buffer
+     * @details Must be called with the mutex held and index < ledCount.
+     */
+    inline void storePixel(uint8_t* out, uint16_t index, uint8_t r, uint8_t g, uint8_t b) {
+        uint8_t* p = out + static_cast<size_t>(index) * 3;
+        p[R_OFFSET] = r;
+        p[G_OFFSET] = g;
+        p[B_OFFSET] = b;
+    }
 
 public:
     Renderer(
@@ -109,7 +284,8 @@ public:
         float speedCoef = 1.0f,
         float peakBrightnessCoef = 0.40f,
         bool repeat = true,
-        bool running = false
+        bool running = false,
+        uint16_t maxLedCount = MAX_LED_COUNT
         ):
         ledCount(ledCount),
         pin(pin),
@@ -120,20 +296,27 @@ public:
         repeat(repeat),
         isRunning_(running),
         exitEarly(false),
-        screen(ledCount, pin, NEO_GRB + NEO_KHZ800)
-    {}
-
-    Renderer(const RenderState& state) {
-        ledCount = state.ledCount;
-        pin = state.pin;
-        frameDelayMs = state.frameDelayMs;
-        repeatDelayMs = state.repeatDelayMs;
-        speedCoefficient = state.speedCoefficient;
-        peakBrightnessCoefficient = state.peakBrightnessCoefficient;
-        repeat = state.repeat;
-        isRunning_ = state.isRunning;
+        screen(std::max(ledCount, maxLedCount), pin, NEO_GRB + NEO_KHZ800)
+    {
+        if (!screen.setActiveLength(ledCount)) {
+            debugf("Output buffer for %d LEDs could not be allocated\n", std::max(ledCount, maxLedCount));
+            this->ledCount = 0;
+        }
+        rebuildGammaLut();
+    }
+
+    Renderer(const RenderState& state, uint16_t maxLedCount = MAX_LED_COUNT) : Renderer(
+        state.ledCount,
+        state.pin,
+        state.frameDelayMs,
+        state.repeatDelayMs,
+        state.speedCoefficient,
+        state.peakBrightnessCoefficient,
+        state.repeat,
+        state.isRunning,
+        maxLedCount
+    ) {
         exitEarly = state.exitEarly;
-        this->screen = Adafruit_NeoPixel(ledCount, pin, NEO_GRB + NEO_KHZ800);
     }
 
     RenderState outputState() const {
@@ -148,11 +331,32 @@ public:
             repeatDelayMs,
             speedCoefficient,
             peakBrightnessCoefficient,
-            currentAnimation.getName(),
-            currentAnimation.getNameHash()
+            currentAnimation->getName().c_str(),
+            currentAnimation->getNameHash()
         };
     }
 
+    /**
+     * @brief Refreshes an existing state in place
+     * @param state The state to overwrite
+     * @details The name is copied into the state's fixed buffer, so neither this nor
+     * outputState() allocates on the render task.
+     */
+    void outputState(RenderState& state) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        state.exitEarly = exitEarly;
+        state.isRunning = isRunning_;
+        state.repeat = repeat;
+        state.ledCount = ledCount;
+        state.pin = pin;
+        state.frameDelayMs = frameDelayMs;
+        state.repeatDelayMs = repeatDelayMs;
+        state.speedCoefficient = speedCoefficient;
+        state.peakBrightnessCoefficient = peakBrightnessCoefficient;
+        state.setAnimationName(currentAnimation->getName().c_str());
+        state.currentAnimationHash = currentAnimation->getNameHash();
+    }
+
     /**
      * @brief Destructor
      * @details Clears the screen before destruction
@@ -163,32 +367,81 @@ public:
         debugln("Renderer destroyed and screen cleared");
     }
 
-    void setAnimation(const Animation& anim) {
-        
-        {
-            // Set the current animation as non-running
-            std::lock_guard<std::mutex> lock(mutex_);
-            this->isRunning_ = false;
+    /**
+     * @brief Sets the animation to play by swapping in a shared animation
+     * @param anim The animation, ideally frozen so it is read without locking
+     * @return True if the animation was set, false if anim is null
+     * @details No frames are copied. The render task holds its own reference to the
+     * previous animation until it notices the switch, so it is never freed mid-frame.
+     */
+    bool setAnimation(std::shared_ptr<const Animation> anim) {
+        if (!anim) {
+            debugln("Refusing to set a null animation");
+            return false;
         }
-        
-        // Give the other thread time to stop rendering task
-        vTaskDelay(this->repeatDelayMs / portTICK_PERIOD_MS);
 
-        
         {
-            // Safely copy the animation data
             std::lock_guard<std::mutex> lock(mutex_);
-
-            debugln("Copying new animation data");
-            currentAnimation = anim;
-        
+            currentAnimation.swap(anim);
             this->isRunning_ = true;
         }
 
         debugf(">> New animation %s set with %d frames\n",
-                currentAnimation.getName().c_str(),
-                currentAnimation.frameCount()
+                anim->getName().c_str(),
+                anim->frameCount()
         );
+        return true;
+    }
+
+    /**
+     * @brief Sets the animation to play
+     * @param anim The animation to copy in
+     * @return True if the animation was set, false if it does not fit the free heap
+     * @details If the renderer holds the only reference to the current animation, it
+     * counts as freed and is let go before the copy, so both never have to fit at once.
+     */
+    bool setAnimation(const Animation& anim) {
+        if (anim.isLoading()) {
+            debugf("Animation '%s' is still loading, pass the shared pointer instead of copying it\n", anim.getName().c_str());
+            return false;
+        }
+
+        if (isHeapSealed()) {
+            debugln("Heap is sealed, copying an animation in is refused - swap in a shared one instead");
+            return false;
+        }
+
+        uint16_t count;
+        std::shared_ptr<const Animation> current;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            count = ledCount;
+            current = currentAnimation;
+        }
+
+        // Freed by the swap only if no one but the renderer and this copy holds it
+        size_t releasedBytes = 0;
+        if (current.use_count() == 2 && current.get() != &anim && !current->isLoading()) {
+            const AnimationStats held = measurePlayable(current->getFrames(), count);
+            releasedBytes = sparseBytes(held.frames, held.pixelEntries);
+        }
+
+        const MemoryPlan plan = planAnimationMemory(measurePlayable(anim.getFrames(), count), count, releasedBytes);
+        if (!plan.fits) {
+            debugf("Animation '%s' does not fit the free heap, keeping the current one\n", anim.getName().c_str());
+            printMemoryPlan(plan);
+            return false;
+        }
+
+        if (releasedBytes > 0) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (currentAnimation == current) currentAnimation = std::make_shared<const Animation>();
+        }
+        current.reset();
+
+        // Copy outside the lock, then swap it in
+        debugln("Copying new animation data");
+        return setAnimation(shareAnimation(Animation(anim)));
     }
 
     /**
@@ -215,14 +468,8 @@ public:
      */
     void initializeScreen() {
         std::lock_guard<std::mutex> lock(mutex_);
-        // NEED new here to heap allocate and keep around
-        Adafruit_NeoPixel* sc = new Adafruit_NeoPixel(ledCount, pin, NEO_GRB + NEO_KHZ800);
-        this->screen = *sc;
         screen.begin();
-
-        for (uint8_t i = 0; i < ledCount; i++) {
-            screen.setPixelColor(i, screen.Color(0, 0, 0)); // Initialize all pixels to off
-        }
+        screen.clear();     // Initialize all pixels to off
         screen.show();
         debugln("NeoPixel screen initialized");
     }
@@ -260,7 +507,78 @@ public:
      */
     void setPeakBrightness(float brightness) {
         std::lock_guard<std::mutex> lock(mutex_);
+        brightnessEnvelope_.active = false;
         peakBrightnessCoefficient = std::clamp(brightness, 0.0f, 1.0f);
+        rebuildOutputLut();
+    }
+
+    /**
+     * @brief Fades the peak brightness to a new level
+     * @param brightness The level to end at
+     * @param durationMs The length of the fade
+     * @param easing The shape of the fade
+     * @details The render task steps the fade once per frame, so callers set it up
+     * once instead of calling setPeakBrightness() in a loop. setPeakBrightness()
+     * cancels a running fade.
+     */
+    void fadeBrightness(float brightness, uint32_t durationMs, Easing easing = Easing::EaseInOut) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        brightnessEnvelope_.start(
+            toQ16(peakBrightnessCoefficient),
+            toQ16(std::clamp(brightness, 0.0f, 1.0f)),
+            millis(),
+            durationMs,
+            easing
+        );
+    }
+
+    /**
+     * @brief Gets the output gamma
+     * @return The gamma exponent, 1.0 for linear output
+     */
+    float getGamma() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return gamma_;
+    }
+
+    /**
+     * @brief Sets the output gamma applied together with the peak brightness
+     * @param gamma The gamma exponent, 1.0 for linear output (default), around 2.2 for perceptual fades
+     */
+    void setGamma(float gamma) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        gamma_ = std::clamp(gamma, 0.1f, 5.0f);
+        rebuildGammaLut();
+    }
+
+    /**
+     * @brief Sets the white balance of the strip
+     * @param red The gain of the red channel, 0.0 to 1.0
+     * @param green The gain of the green channel, 0.0 to 1.0
+     * @param blue The gain of the blue channel, 0.0 to 1.0
+     * @details Corrects the color cast of a strip batch, e.g. (1.0, 0.85, 0.7) for a
+     * strip that renders white too blue. The gains are folded into the output tables
+     * together with brightness and gamma, so they cost nothing per pixel.
+     */
+    void setWhiteBalance(float red, float green, float blue) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        whiteBalanceQ16_[0] = static_cast<uint32_t>(toQ16(std::clamp(red, 0.0f, 1.0f)));
+        whiteBalanceQ16_[1] = static_cast<uint32_t>(toQ16(std::clamp(green, 0.0f, 1.0f)));
+        whiteBalanceQ16_[2] = static_cast<uint32_t>(toQ16(std::clamp(blue, 0.0f, 1.0f)));
+        rebuildOutputLut();
+    }
+
+    /**
+     * @brief Gets the white balance gains
+     * @param red Set to the gain of the red channel
+     * @param green Set to the gain of the green channel
+     * @param blue Set to the gain of the blue channel
+     */
+    void getWhiteBalance(float& red, float& green, float& blue) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        red = fromQ16(whiteBalanceQ16_[0]);
+        green = fromQ16(whiteBalanceQ16_[1]);
+        blue = fromQ16(whiteBalanceQ16_[2]);
     }
 
     /**
@@ -274,29 +592,214 @@ public:
         screen.setPixelColor(pixel.index, screen.Color(pixel.r, pixel.g, pixel.b));
     }
 
+    /**
+     * @brief Writes a span of pixels to the output buffer under a single lock
+     * @param pixels The pixels to write
+     * @param count The number of pixels
+     * @param applyOutput Apply the brightness and gamma tables, otherwise write the colors as given
+     * @details Pixels outside the strip are skipped. Call showScreen() to display them.
+     */
+    void writePixels(const Pixel* pixels, size_t count, bool applyOutput = true) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        uint8_t* out = screen.getPixels();
+        const uint16_t limit = ledCount;
+
+        if (applyOutput) {
+            for (size_t i = 0; i < count; i++) {
+                const Pixel& pixel = pixels[i];
+                if (pixel.index >= limit) continue;
+                storePixel(out, pixel.index, outputLut_[0][pixel.r], outputLut_[1][pixel.g], outputLut_[2][pixel.b]);
+            }
+        } else {
+            for (size_t i = 0; i < count; i++) {
+                const Pixel& pixel = pixels[i];
+                if (pixel.index >= limit) continue;
+                storePixel(out, pixel.index, pixel.r, pixel.g, pixel.b);
+            }
+        }
+    }
+
+    /**
+     * @brief Writes a dense RGB buffer to consecutive LEDs under a single lock
+     * @param start The first LED to write
+     * @param rgb Tightly packed r, g, b bytes, three per LED
+     * @param count The number of LEDs in the buffer
+     * @param applyOutput Apply the brightness and gamma tables, otherwise write the colors as given
+     * @details The range is clipped to the strip once, the copy loop itself has no bounds checks.
+     */
+    void writeRgb(uint16_t start, const uint8_t* rgb, size_t count, bool applyOutput = true) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (start >= ledCount) return;
+        count = std::min<size_t>(count, ledCount - start);
+
+        uint8_t* __restrict out = screen.getPixels() + static_cast<size_t>(start) * 3;
+        const uint8_t* __restrict in = rgb;
+
+        if (applyOutput) {
+            const uint8_t* lutR = outputLut_[0];
+            const uint8_t* lutG = outputLut_[1];
+            const uint8_t* lutB = outputLut_[2];
+            for (size_t i = 0; i < count; i++) {
+                out[3 * i + R_OFFSET] = lutR[in[3 * i + 0]];
+                out[3 * i + G_OFFSET] = lutG[in[3 * i + 1]];
+                out[3 * i + B_OFFSET] = lutB[in[3 * i + 2]];
+            }
+        } else {
+            for (size_t i = 0; i < count; i++) {
+                out[3 * i + R_OFFSET] = in[3 * i + 0];
+                out[3 * i + G_OFFSET] = in[3 * i + 1];
+                out[3 * i + B_OFFSET] = in[3 * i + 2];
+            }
+        }
+    }
+
+    /**
+     * @brief Fills a range of LEDs with one color under a single lock
+     * @param start The first LED to fill
+     * @param count The number of LEDs to fill
+     * @param r The red value
+     * @param g The green value
+     * @param b The blue value
+     * @param applyOutput Apply the brightness and gamma tables, otherwise write the color as given
+     */
+    void fillRange(uint16_t start, size_t count, uint8_t r, uint8_t g, uint8_t b, bool applyOutput = true) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (start >= ledCount) return;
+        count = std::min<size_t>(count, ledCount - start);
+
+        uint8_t color[3];
+        color[R_OFFSET] = applyOutput ? outputLut_[0][r] : r;
+        color[G_OFFSET] = applyOutput ? outputLut_[1][g] : g;
+        color[B_OFFSET] = applyOutput ? outputLut_[2][b] : b;
+
+        uint8_t* __restrict out = screen.getPixels() + static_cast<size_t>(start) * 3;
+        for (size_t i = 0; i < count; i++) {
+            out[3 * i + 0] = color[0];
+            out[3 * i + 1] = color[1];
+            out[3 * i + 2] = color[2];
+        }
+    }
+
     /**
      * @brief Writes a frame to the screen
      * @param frame The frame to write
      * @details This method is thread-safe and locks the mutex while writing the frame
      */
     void writeFrameToScreen(const Frame& frame) {
+        writeFrameToScreen(frame.data(), frame.size());
+    }
+
+    /**
+     * @brief Writes a frame held in a pixel span to the screen
+     * @param pixels The pixels of the frame, e.g. a staged copy from the FrameStager
+     * @param count The number of pixels
+     */
+    void writeFrameToScreen(const Pixel* pixels, size_t count) {
         debugln(">> Writing frame to screen");
         std::lock_guard<std::mutex> lock(mutex_);
         debugln(">> Grabbed Lock 4 screen");
-        for (const Pixel& pixel : frame) {
+        uint8_t* out = screen.getPixels();
+        for (size_t i = 0; i < count; i++) {
+            const Pixel& pixel = pixels[i];
             if (pixel.index >= ledCount) continue;
-            screen.setPixelColor(
-                pixel.index,
-                static_cast<uint8_t>(pixel.r * peakBrightnessCoefficient),
-                static_cast<uint8_t>(pixel.g * peakBrightnessCoefficient),
-                static_cast<uint8_t>(pixel.b * peakBrightnessCoefficient)
-            );
+            storePixel(out, pixel.index, outputLut_[0][pixel.r], outputLut_[1][pixel.g], outputLut_[2][pixel.b]);
         }
         debugln(">> Wrote pixel data to buffer");
         screen.show();
         debugln(">> Frame written to screen");
     }
 
+    /**
+     * @brief Writes a frame with known bounds to the screen
+     * @param pixels The pixels of the frame
+     * @param count The number of pixels
+     * @param bounds The LEDs the frame touches, from Animation::getFrameBounds()
+     * @details A frame that touches no LED of the strip leaves the output as it is,
+     * so neither the buffer nor the strip is written, unless skipped frames are
+     * waiting to be shown.
+     */
+    void writeFrameToScreen(const Pixel* pixels, size_t count, const FrameBounds& bounds) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (composeFrameLocked(pixels, count, bounds) || pendingShow_) {
+            screen.show();
+            pendingShow_ = false;
+        }
+    }
+
+    /**
+     * @brief Draws a frame into the output buffer without showing it
+     * @param pixels The pixels of the frame
+     * @param count The number of pixels
+     * @param bounds The LEDs the frame touches
+     * @details Used to skip a frame under overload: frames are drawn over each other,
+     * so a skipped frame still has to land in the buffer, only its show() is saved.
+     * The next frame written shows it even if it changes nothing itself.
+     */
+    void composeFrame(const Pixel* pixels, size_t count, const FrameBounds& bounds) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (composeFrameLocked(pixels, count, bounds)) pendingShow_ = true;
+    }
+
+    /**
+     * @brief Counts a shown frame in the telemetry
+     * @param workUs The time spent composing and showing it
+     * @param periodUs The frame period it had to fit in, 0 if unknown
+     * @param skipped The frames skipped after it to catch up
+     */
+    void recordFrame(uint32_t workUs, uint32_t periodUs, uint32_t skipped) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        telemetry_.framesShown++;
+        telemetry_.framesSkipped += skipped;
+        if ((periodUs > 0 && workUs > periodUs) || skipped > 0) telemetry_.overruns++;
+        telemetry_.lastFrameUs = workUs;
+        telemetry_.maxFrameUs = std::max(telemetry_.maxFrameUs, workUs);
+        telemetry_.helperChunks += helper_.takeHelped();
+    }
+
+    /**
+     * @brief Splits the compose of large frames across both cores
+     * @param enabled Start or stop the helper task
+     * @param helperCore The core to run the helper on, the app core (0) by default
+     * @return False if the helper could not be started, e.g. after sealHeap()
+     * @details For very long strips where composing a frame alone takes longer than the
+     * frame period. Frames of PARALLEL_COMPOSE_MIN_PIXELS or more with sorted indices
+     * are composed in chunks claimed by the render task and the helper, with a barrier
+     * before show(). The helper waits just above idle priority and only takes chunks when
+     * its core has time to spare. It holds the render task's priority while it works on a
+     * chunk, so at the barrier the render task blocks for at most the chunk in progress.
+     */
+    bool setParallelCompose(bool enabled, BaseType_t helperCore = 0) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!enabled) helper_.end();
+        else if (!helper_.begin(helperCore)) return false;
+        parallelCompose_ = enabled;
+        return true;
+    }
+
+    /**
+     * @brief Checks if parallel compose is enabled
+     */
+    bool getParallelCompose() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return parallelCompose_;
+    }
+
+    /**
+     * @brief Gets the playback telemetry
+     */
+    PlaybackTelemetry getTelemetry() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return telemetry_;
+    }
+
+    /**
+     * @brief Resets the playback telemetry counters
+     */
+    void resetTelemetry() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        telemetry_ = PlaybackTelemetry();
+    }
+
     /**
      * @brief Sets the repeat state of the renderer
      * @param repeat The new repeat state
@@ -324,9 +827,58 @@ public:
      */
     void setSpeed(float speed) {
         std::lock_guard<std::mutex> lock(mutex_);
+        speedEnvelope_.active = false;
         speedCoefficient = std::max(0.1f, speed); // Ensure speed is not zero
     }
 
+    /**
+     * @brief Ramps the speed coefficient to a new value
+     * @param speed The speed to end at
+     * @param durationMs The length of the ramp
+     * @param easing The shape of the ramp
+     * @details Stepped once per frame by the render task. setSpeed() cancels a running ramp.
+     */
+    void rampSpeed(float speed, uint32_t durationMs, Easing easing = Easing::EaseInOut) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        speedEnvelope_.start(
+            toQ16(speedCoefficient),
+            toQ16(std::max(0.1f, speed)),
+            millis(),
+            durationMs,
+            easing
+        );
+    }
+
+    /**
+     * @brief Steps the brightness and speed envelopes
+     * @param nowMs The current millis() timestamp
+     * @details Called by the render loops once per frame. The output tables are only
+     * rebuilt when the brightness actually moved.
+     */
+    void updateEnvelopes(uint32_t nowMs) {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        if (brightnessEnvelope_.active) {
+            const float brightness = std::clamp(fromQ16(brightnessEnvelope_.valueAt(nowMs)), 0.0f, 1.0f);
+            if (brightness != peakBrightnessCoefficient) {
+                peakBrightnessCoefficient = brightness;
+                rebuildOutputLut();
+            }
+            if (brightnessEnvelope_.isDone(nowMs)) {
+                brightnessEnvelope_.active = false;
+                events_.post({RenderEventType::TransitionDone, static_cast<uint32_t>(Transition::Brightness), currentAnimation->getNameHash()});
+            }
+        }
+
+        if (speedEnvelope_.active) {
+            speedCoefficient = std::max(0.1f, fromQ16(speedEnvelope_.valueAt(nowMs)));
+            if (speedEnvelope_.isDone(nowMs)) {
+                speedEnvelope_.active = false;
+                events_.post({RenderEventType::TransitionDone, static_cast<uint32_t>(Transition::Speed), currentAnimation->getNameHash()});
+            }
+        }
+    }
+
     /**
      * @brief Gets the animation speed coefficient
      * @return The current speed coefficient
@@ -349,14 +901,28 @@ public:
     /**
      * @brief Sets the LED count
      * @param count The new LED count
+     * @return True if the LED count was set, false if it is 0 or beyond the preallocated maximum
+     * @details Only changes how much of the preallocated output buffer is shown, so
+     * it never allocates and is allowed after sealHeap().
      */
-    void setLedCount(uint16_t count) {
+    bool setLedCount(uint16_t count) {
         std::lock_guard<std::mutex> lock(mutex_);
-        if (count == 0 || count > 65535) return;
+        if (count > screen.capacity()) {
+            debugf("LED count %d exceeds the preallocated maximum of %d\n", count, screen.capacity());
+            return false;
+        }
+        if (!screen.setActiveLength(count)) return false;
         ledCount = count;
-        screen.updateLength(ledCount);
-        screen.begin();
         debugf("LED count set to %d\n", ledCount);
+        return true;
+    }
+
+    /**
+     * @brief Gets the most LEDs the output buffer was allocated for
+     */
+    uint16_t getMaxLedCount() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return screen.capacity();
     }
     
 
@@ -381,9 +947,18 @@ public:
      * @brief Gets the current animation name
      * @return The name of the current animation
      */
-    const std::string& getCurrentAnimationName() const {
+    std::string getCurrentAnimationName() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return currentAnimation->getName();
+    }
+
+    /**
+     * @brief Gets a shared reference to the current animation
+     * @return The current animation, kept alive for as long as the caller holds it
+     */
+    std::shared_ptr<const Animation> getCurrentAnimation() const {
         std::lock_guard<std::mutex> lock(mutex_);
-        return currentAnimation.getName();
+        return currentAnimation;
     }
 
     /**
@@ -401,7 +976,7 @@ public:
      */
     bool isAnimationEmpty() const {
         std::lock_guard<std::mutex> lock(mutex_);
-        return currentAnimation.getFrames().empty();
+        return currentAnimation->getFrames().empty();
     }
 
     /**
@@ -416,10 +991,310 @@ public:
     /**
      * @brief Get a reference to the current Animation FrameBuffer
      * @return const reference to the current Animation FrameBuffer
+     * @warning Only valid until the animation is replaced, hold getCurrentAnimation() to keep it alive
      */
     const FrameBuffer& getCurrentAnimationFrames() const {
         std::lock_guard<std::mutex> lock(mutex_);
-        return currentAnimation.getFrames();
+        return currentAnimation->getFrames();
+    }
+
+    /**
+     * @brief Gets the stager that prefetches frames into internal SRAM
+     * @warning For use by the render task only, and by setup() to size it before the render task starts
+     */
+    FrameStager& frameStager() {
+        return stager_;
+    }
+
+    /**
+     * @brief Gets the render events, to subscribe on and dispatch from the app task
+     * @details Covers animation playback, segments post no events.
+     */
+    RenderEvents& events() {
+        return events_;
+    }
+
+    /**
+     * @brief Adds a zone of the strip that plays its own animation
+     * @param start The first LED of the segment
+     * @param length The number of LEDs in the segment
+     * @return The id of the new segment, or -1 if the range is invalid or overlaps another segment
+     */
+    int addSegment(uint16_t start, uint16_t length) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (isHeapSealed()) {
+            debugln("Heap is sealed, segments must be added in setup()");
+            return -1;
+        }
+        if (length == 0 || static_cast<uint32_t>(start) + length > 65535) {
+            debugf("Invalid segment range %d + %d\n", start, length);
+            return -1;
+        }
+        for (const Segment& segment : segments_) {
+            if (segment.overlaps(start, length)) {
+                debugf("Segment %d + %d overlaps an existing segment\n", start, length);
+                return -1;
+            }
+        }
+        segments_.emplace_back(start, length, frameDelayMs, repeatDelayMs);
+        debugf("Segment %zu added at %d with %d LEDs\n", segments_.size() - 1, start, length);
+        return static_cast<int>(segments_.size() - 1);
+    }
+
+    /**
+     * @brief Removes all segments and returns to whole-strip playback
+     */
+    void clearSegments() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        segments_.clear();
+        screen.clear();
+    }
+
+    /**
+     * @brief Checks if the strip is split into segments
+     * @return True if at least one segment exists, false otherwise
+     */
+    bool hasSegments() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return !segments_.empty();
+    }
+
+    /**
+     * @brief Sets the animation played in a segment and rewinds its cursor
+     * @param id The segment id returned by addSegment()
+     * @param anim The animation, with pixel indices relative to the segment start
+     * @return True if the segment exists, false otherwise
+     * @details A progressive animation plays its published frames while it loads.
+     */
+    bool setSegmentAnimation(int id, std::shared_ptr<const Animation> anim) {
+        if (!anim) return false;
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (id < 0 || static_cast<size_t>(id) >= segments_.size()) return false;
+        Segment& segment = segments_[id];
+        segment.animation.swap(anim);
+        segment.rewind(millis());
+        segment.running = segment.animation->frameCount() > 0;
+        debugf(">> Segment %d playing %s with %zu frames\n", id, segment.animation->getName().c_str(), segment.animation->frameCount());
+        return true;
+    }
+
+    /**
+     * @brief Sets the animation played in a segment from a copy
+     * @param id The segment id returned by addSegment()
+     * @param anim The animation to copy in
+     * @return True if the segment exists, false otherwise
+     */
+    bool setSegmentAnimation(int id, const Animation& anim) {
+        if (isHeapSealed()) {
+            debugln("Heap is sealed, copying an animation in is refused - swap in a shared one instead");
+            return false;
+        }
+        return setSegmentAnimation(id, shareAnimation(Animation(anim)));
+    }
+
+    /**
+     * @brief Sets the speed coefficient of a segment
+     * @param id The segment id
+     * @param speed The new speed coefficient
+     * @return True if the segment exists, false otherwise
+     */
+    bool setSegmentSpeed(int id, float speed) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (id < 0 || static_cast<size_t>(id) >= segments_.size()) return false;
+        segments_[id].speedCoefficient = std::max(0.1f, speed);
+        return true;
+    }
+
+    /**
+     * @brief Sets the brightness of a segment relative to the peak brightness
+     * @param id The segment id
+     * @param brightness The new brightness coefficient
+     * @return True if the segment exists, false otherwise
+     */
+    bool setSegmentBrightness(int id, float brightness) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (id < 0 || static_cast<size_t>(id) >= segments_.size()) return false;
+        segments_[id].brightnessCoefficient = std::clamp(brightness, 0.0f, 1.0f);
+        return true;
+    }
+
+    /**
+     * @brief Sets the frame and repeat delays of a segment
+     * @param id The segment id
+     * @param frameMs The delay between frames in milliseconds
+     * @param repeatMs The delay before repeating in milliseconds
+     * @return True if the segment exists, false otherwise
+     */
+    bool setSegmentDelays(int id, uint16_t frameMs, uint16_t repeatMs) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (id < 0 || static_cast<size_t>(id) >= segments_.size()) return false;
+        segments_[id].frameDelayMs = frameMs;
+        segments_[id].repeatDelayMs = repeatMs;
+        return true;
+    }
+
+    /**
+     * @brief Sets the repeat and running state of a segment
+     * @param id The segment id
+     * @param repeat Loop the segment animation
+     * @param running Play or pause the segment
+     * @return True if the segment exists, false otherwise
+     */
+    bool setSegmentPlayback(int id, bool repeat, bool running) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (id < 0 || static_cast<size_t>(id) >= segments_.size()) return false;
+        segments_[id].repeat = repeat;
+        if (running && !segments_[id].running) segments_[id].nextFrameAtMs = millis();
+        segments_[id].running = running;
+        return true;
+    }
+
+    /**
+     * @brief Composes every segment with a frame due into the output buffer
+     * @param nowMs The current millis() timestamp
+     * @return Milliseconds until the next segment frame is due
+     * @details Takes the lock once for all segments and flushes them with a single show().
+     */
+    unsigned long composeSegments(uint32_t nowMs) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        bool dirty = false;
+        unsigned long untilNext = frameDelayMs;
+
+        for (Segment& segment : segments_) {
+            // A segment that fell behind draws every frame it owes, only the last one is seen
+            size_t steps = 0;
+            while (segment.isDue(nowMs)) {
+                const FrameBuffer& frames = segment.animation->getFrames();
+                // A progressive load only hands out the frames it published, like render() does
+                const bool loading = segment.animation->isLoading();
+                const size_t ready = segment.animation->readyFrameCount();
+                if (segment.cursor >= ready && loading) {
+                    // Hold the last frame until the loader publishes this one
+                    segment.nextFrameAtMs = nowMs + PROGRESSIVE_STALL_MS;
+                    break;
+                }
+                // While loading the cursor wraps at the full length, after it at the frames published
+                const size_t end = loading ? frames.size() : ready;
+                // LEDs of the segment that are on the strip
+                const uint32_t window = segment.start < ledCount ? std::min<uint32_t>(segment.length, ledCount - segment.start) : 0;
+                const FrameBounds bounds = segment.animation->getFrameBounds(segment.cursor);
+
+                // Frames that touch nothing inside the window leave the output unchanged
+                if (segment.cursor < ready && bounds.touches(0, window)) {
+                    // Scale by the segment's own brightness, then through the shared output tables
+                    const uint32_t level = static_cast<uint32_t>(toQ16(segment.brightnessCoefficient));
+                    const bool clip = !bounds.within(window);
+                    uint8_t* out = screen.getPixels();
+                    for (const Pixel& pixel : frames[segment.cursor]) {
+                        if (clip && pixel.index >= window) continue;
+                        storePixel(
+                            out,
+                            segment.start + pixel.index,
+                            outputLut_[0][(pixel.r * level) >> 16],
+                            outputLut_[1][(pixel.g * level) >> 16],
+                            outputLut_[2][(pixel.b * level) >> 16]
+                        );
+                    }
+                    dirty = true;
+                }
+
+                // Scheduled from the due time, not from now, so a late frame does not delay the rest
+                const uint32_t frameMs = std::max<uint32_t>(1, static_cast<uint32_t>(segment.frameDelayMs / segment.speedCoefficient));
+                segment.nextFrameAtMs += frameMs;
+                if (++segment.cursor >= end) {
+                    segment.cursor = 0;
+                    segment.running = segment.repeat;
+                    segment.nextFrameAtMs += segment.repeatDelayMs;
+                }
+
+                // Still behind after a whole cycle: drop the backlog rather than spin on it
+                if (++steps >= std::max<size_t>(end, 1) && segment.isDue(nowMs)) {
+                    segment.nextFrameAtMs = nowMs + frameMs;
+                    break;
+                }
+            }
+            if (steps > 1) telemetry_.framesSkipped += steps - 1;
+
+            if (!segment.running) continue;
+            const int32_t wait = static_cast<int32_t>(segment.nextFrameAtMs - nowMs);
+            untilNext = std::min(untilNext, static_cast<unsigned long>(std::max<int32_t>(wait, 0)));
+        }
+
+        if (dirty) screen.show();
+        return untilNext;
+    }
+
+    /**
+     * @brief Slaves playback to an external timecode source
+     * @param source The source to follow, or nullptr to free-run on relative delays again
+     * @details The source must outlive the renderer or be detached first.
+     */
+    void setTimecodeSource(TimecodeSource* source) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        timecode_ = source;
+        clock_.reset(0);
+    }
+
+    /**
+     * @brief Checks if playback follows an external timecode source
+     * @return True if a timecode source is attached, false otherwise
+     */
+    bool isClockSynced() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return timecode_ != nullptr;
+    }
+
+    /**
+     * @brief Advances frames on an external trigger instead of a timer
+     * @param trigger The trigger to follow, or nullptr to play on the frame delay again
+     * @param mode Step to show one frame per trigger, Tempo to treat triggers as beats
+     * @param framesPerBeat In Tempo mode, the frames spread evenly over each beat
+     * @details The trigger wakes the render task directly, so a frame goes out as soon
+     * as the trigger fires. In Tempo mode each beat shows frame beat * framesPerBeat and
+     * the frames up to the next beat follow at the measured tempo; if the next beat is
+     * late, the last of them is held. The trigger must outlive the renderer or be
+     * detached first.
+     */
+    void setFrameTrigger(FrameTrigger* trigger, TriggerMode mode = TriggerMode::Step, uint16_t framesPerBeat = 4) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        trigger_ = trigger;
+        triggerMode_ = mode;
+        framesPerBeat_ = std::max<uint16_t>(framesPerBeat, 1);
+    }
+
+    /**
+     * @brief Gets the frame trigger, nullptr when playing on the frame delay
+     */
+    FrameTrigger* getFrameTrigger() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return trigger_;
+    }
+
+    /**
+     * @brief Gets how the frame trigger advances frames
+     */
+    TriggerMode getTriggerMode() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return triggerMode_;
+    }
+
+    /**
+     * @brief Gets the frames spread over each beat in Tempo mode
+     */
+    uint16_t getFramesPerBeat() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return framesPerBeat_;
+    }
+
+    /**
+     * @brief Reads the timecode source and returns the phase-locked animation clock
+     * @return The animation clock in milliseconds
+     */
+    uint32_t syncClock() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        uint32_t referenceMs = 0;
+        if (timecode_ != nullptr && timecode_->poll(referenceMs)) clock_.discipline(referenceMs);
+        return clock_.nowMs();
     }
 
     bool interruptableDelay(
@@ -452,7 +1327,31 @@ public:
 /**
  * Render the current animation with the given renderer settings.
  * @param rend The renderer to use
+ * @details If the strip is split into segments, this plays the segments instead.
  */
 RenderState render(Renderer& rend);
 
+/**
+ * Render the current animation at the position given by a clock.
+ * @param rend The renderer to use
+ * @details The clock is the external timecode when one is attached, otherwise the
+ * time since playback started, used for animations with per-frame timestamps.
+ * Sleeps until the next frame change instead of ticking at a fixed rate.
+ */
+RenderState renderSynced(Renderer& rend);
+
+/**
+ * Render the current animation one frame per external trigger, or spread over its beats.
+ * @param rend The renderer to use
+ * @details Blocks on the trigger's task notification between frames, see
+ * Renderer::setFrameTrigger().
+ */
+RenderState renderTriggered(Renderer& rend);
+
+/**
+ * Render every segment of the renderer until it is stopped or interrupted.
+ * @param rend The renderer to use
+ */
+RenderState renderSegments(Renderer& rend);
+
 #endif
\ No newline at end of file
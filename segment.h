@@ -0,0 +1,62 @@
+#pragma once
+#ifndef SEGMENT_H
+#define SEGMENT_H
+
+#include "animation.h"
+
+
+/**
+ * @brief An independent zone of the LED strip
+ * @details A segment covers the LEDs [start, start + length) and plays its own
+ * animation with its own speed, brightness and playback cursor. Pixel indices in
+ * the segment's animation are relative to the start of the segment.
+ * All segments of a Renderer are composed into the same output buffer and
+ * flushed with a single show().
+ */
+struct Segment {
+    uint16_t start = 0;                     // First LED of the segment
+    uint16_t length = 0;                    // Number of LEDs in the segment
+    std::shared_ptr<const Animation> animation = std::make_shared<const Animation>(); // Animation played in this segment
+    uint16_t frameDelayMs = 50;             // Delay between frames in milliseconds
+    uint16_t repeatDelayMs = 50;            // Delay before repeating the animation in milliseconds
+    float speedCoefficient = 1.0f;          // Speed coefficient for this segment
+    float brightnessCoefficient = 1.0f;     // Brightness relative to the renderer peak brightness
+    bool repeat = true;                     // Loop the animation
+    bool running = false;                   // Whether the segment is playing
+    size_t cursor = 0;                      // Index of the next frame to show
+    uint32_t nextFrameAtMs = 0;             // millis() timestamp the next frame is due at
+
+    Segment(
+        uint16_t start = 0,
+        uint16_t length = 0,
+        uint16_t frameDelayMs = 50,
+        uint16_t repeatDelayMs = 50
+    ) : start(start), length(length), frameDelayMs(frameDelayMs), repeatDelayMs(repeatDelayMs) {}
+
+    /**
+     * @brief Checks if the segment overlaps the range [otherStart, otherStart + otherLength)
+     */
+    bool overlaps(uint16_t otherStart, uint16_t otherLength) const {
+        return static_cast<uint32_t>(start) < static_cast<uint32_t>(otherStart) + otherLength &&
+               static_cast<uint32_t>(otherStart) < static_cast<uint32_t>(start) + length;
+    }
+
+    /**
+     * @brief Checks if the segment has a frame due at the given time
+     * @param nowMs The current millis() timestamp
+     */
+    bool isDue(uint32_t nowMs) const {
+        return running && static_cast<int32_t>(nowMs - nextFrameAtMs) >= 0;
+    }
+
+    /**
+     * @brief Rewind the playback cursor
+     * @param nowMs The current millis() timestamp
+     */
+    void rewind(uint32_t nowMs) {
+        cursor = 0;
+        nextFrameAtMs = nowMs;
+    }
+};
+
+#endif
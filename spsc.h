@@ -0,0 +1,81 @@
+#pragma once
+#ifndef SPSC_H
+#define SPSC_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+
+/**
+ * @brief Bounded lock-free queue for one producer task and one consumer task
+ * @details Slots are preallocated, push and pop never block and never allocate
+ * beyond what moving a T does. The producer only writes tail_, the consumer only
+ * writes head_, so each side needs a single atomic load and store per operation.
+ * @tparam T The item type, moved in and out of the slots
+ * @tparam N The capacity, a power of two
+ */
+template <typename T, size_t N>
+struct SpscQueue {
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "SpscQueue capacity must be a power of two");
+
+private:
+    std::array<T, N> slots_;
+    std::atomic<size_t> head_{0};   // Next slot to pop, written by the consumer
+    std::atomic<size_t> tail_{0};   // Next slot to push, written by the producer
+
+public:
+    /**
+     * @brief Push an item, from the producer only
+     * @return False if the queue is full, the item is left untouched then
+     */
+    bool push(T&& item) {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) == N) return false;
+        slots_[tail & (N - 1)] = std::move(item);
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Push a copy of an item, from the producer only
+     * @return False if the queue is full
+     */
+    bool push(const T& item) {
+        T copy = item;
+        return push(std::move(copy));
+    }
+
+    /**
+     * @brief Pop an item, from the consumer only
+     * @return False if the queue is empty
+     */
+    bool pop(T& item) {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_acquire)) return false;
+        item = std::move(slots_[head & (N - 1)]);
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Checks if the queue is empty, exact only from the consumer
+     */
+    bool empty() const {
+        return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Get the number of queued items, approximate from other tasks
+     */
+    size_t size() const {
+        return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+    }
+
+    static constexpr size_t capacity() {
+        return N;
+    }
+};
+
+#endif
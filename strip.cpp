@@ -0,0 +1,23 @@
+#include "strip.h"
+#include <string.h>
+
+OutputStrip::OutputStrip(uint16_t capacity, int16_t pin, neoPixelType type) :
+    Adafruit_NeoPixel(capacity, pin, type),
+    capacity_(numLEDs),
+    bytesPerLed_(numLEDs > 0 ? numBytes / numLEDs : 3)
+{}
+
+
+bool OutputStrip::setActiveLength(uint16_t count) {
+    if (count == 0 || count > capacity_) return false;
+
+    if (count < numLEDs) {
+        memset(pixels + static_cast<size_t>(count) * bytesPerLed_, 0, numBytes - static_cast<size_t>(count) * bytesPerLed_);
+        // Before begin() the pin is not set up, e.g. in a global Renderer's constructor
+        if (begun) show();
+    }
+
+    numLEDs = count;
+    numBytes = static_cast<uint16_t>(count * bytesPerLed_);
+    return true;
+}
@@ -0,0 +1,56 @@
+#pragma once
+#ifndef STRIP_H
+#define STRIP_H
+
+#include <Adafruit_NeoPixel.h>
+#include <cstdint>
+
+/**
+ * @brief Longest strip the output buffer is allocated for by default
+ */
+#define MAX_LED_COUNT 1024
+
+
+/**
+ * @brief A NeoPixel strip whose output buffer is allocated once for a maximum length
+ * @details The active length changes within the capacity without touching the heap.
+ * The strip owns its buffer and cannot be copied: a copy of the base class shares
+ * the buffer and frees it twice.
+ */
+class OutputStrip : public Adafruit_NeoPixel {
+private:
+    uint16_t capacity_;         // LEDs the buffer was allocated for
+    uint8_t bytesPerLed_;       // 3 for RGB, 4 for RGBW
+
+public:
+    /**
+     * @brief Allocate the output buffer
+     * @param capacity The most LEDs the strip will ever drive
+     * @param pin The data pin
+     * @param type The color order and timing, e.g. NEO_GRB + NEO_KHZ800
+     * @details If the buffer cannot be allocated, the capacity is 0.
+     */
+    OutputStrip(uint16_t capacity, int16_t pin, neoPixelType type);
+
+    OutputStrip(const OutputStrip&) = delete;
+    OutputStrip& operator=(const OutputStrip&) = delete;
+
+    /**
+     * @brief Get the number of LEDs the buffer holds
+     */
+    uint16_t capacity() const {
+        return capacity_;
+    }
+
+    /**
+     * @brief Change the number of LEDs written by show()
+     * @param count The new length
+     * @return False if count is 0 or beyond the capacity
+     * @details LEDs that drop off the end are turned off first, while they are still
+     * addressed. Before begin() only the buffer is cleared, nothing is sent to the pin.
+     * Never allocates.
+     */
+    bool setActiveLength(uint16_t count);
+};
+
+#endif
@@ -0,0 +1,679 @@
+/**
+ * animopt - host optimizer for ESP32Animator animations
+ *
+ * Reads animation JSON files and writes the binary .anim form that loadAnimation()
+ * decodes on the device without JSON parsing. Every encoding step is measured and
+ * reported per file, so the content pipeline can see what each one buys before
+ * deploying.
+ *
+ * Build (any C++17 compiler, no dependencies):
+ *     g++ -std=c++17 -O2 -o animopt tools/animopt/animopt.cpp
+ *
+ * Usage:
+ *     animopt [-o DIR] [-n] FILE.json...
+ *         -o DIR  Write the .anim files to DIR instead of next to the inputs
+ *         -n      Report only, write nothing
+ */
+
+#include "../../animformat.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+// Cost model of the device, rough figures for an ESP32-S3 at 240 MHz reading
+// LittleFS. Calibrate against measurements before trusting the absolute numbers.
+static const double FLASH_BYTES_PER_US = 1.0;   // File system read throughput
+static const double JSON_NS_PER_BYTE = 120.0;   // ArduinoJson parse plus pixel conversion
+static const double DECODE_NS_PER_PIXEL = 40.0; // Span expansion into sparse pixels
+static const double LZ_NS_PER_BYTE = 8.0;       // animLzDecompress output rate
+static const double COMPOSE_NS_PER_PIXEL = 25.0;// LUT lookup and store per pixel entry
+
+
+/* ------------------------------------------------------------------ JSON */
+
+/**
+ * Just enough JSON for animation files: objects, arrays, numbers, strings,
+ * true, false and null.
+ */
+struct Json {
+    enum Type { Null, Bool, Number, String, Array, Object } type = Null;
+    double number = 0;
+    std::string text;
+    std::vector<Json> items;
+    std::vector<std::pair<std::string, Json>> members;
+
+    const Json& operator[](const std::string& key) const {
+        static const Json missing;
+        for (const auto& member : members) if (member.first == key) return member.second;
+        return missing;
+    }
+    bool isNull() const { return type == Null; }
+    long asInt(long fallback = 0) const { return type == Number ? static_cast<long>(number) : fallback; }
+};
+
+struct JsonParser {
+    const std::string& in;
+    size_t pos = 0;
+    std::string error;
+
+    explicit JsonParser(const std::string& text) : in(text) {}
+
+    void skip() {
+        while (pos < in.size() && isspace(static_cast<unsigned char>(in[pos]))) pos++;
+    }
+
+    bool fail(const char* what) {
+        if (error.empty()) error = std::string(what) + " at byte " + std::to_string(pos);
+        return false;
+    }
+
+    bool literal(const char* word) {
+        const size_t length = strlen(word);
+        if (in.compare(pos, length, word) != 0) return fail("unexpected token");
+        pos += length;
+        return true;
+    }
+
+    bool string(std::string& out) {
+        if (in[pos] != '"') return fail("expected string");
+        pos++;
+        while (pos < in.size() && in[pos] != '"') {
+            if (in[pos] == '\\' && pos + 1 < in.size()) pos++;
+            out += in[pos++];
+        }
+        if (pos >= in.size()) return fail("unterminated string");
+        pos++;
+        return true;
+    }
+
+    bool value(Json& out) {
+        skip();
+        if (pos >= in.size()) return fail("unexpected end");
+        const char c = in[pos];
+
+        if (c == '{') {
+            out.type = Json::Object;
+            pos++;
+            skip();
+            if (in[pos] == '}') { pos++; return true; }
+            while (true) {
+                skip();
+                std::string key;
+                if (!string(key)) return false;
+                skip();
+                if (in[pos++] != ':') return fail("expected ':'");
+                out.members.emplace_back(key, Json());
+                if (!value(out.members.back().second)) return false;
+                skip();
+                if (in[pos] == ',') { pos++; continue; }
+                if (in[pos] == '}') { pos++; return true; }
+                return fail("expected ',' or '}'");
+            }
+        }
+
+        if (c == '[') {
+            out.type = Json::Array;
+            pos++;
+            skip();
+            if (in[pos] == ']') { pos++; return true; }
+            while (true) {
+                out.items.emplace_back();
+                if (!value(out.items.back())) return false;
+                skip();
+                if (in[pos] == ',') { pos++; continue; }
+                if (in[pos] == ']') { pos++; return true; }
+                return fail("expected ',' or ']'");
+            }
+        }
+
+        if (c == '"') {
+            out.type = Json::String;
+            return string(out.text);
+        }
+        if (c == 't') { out.type = Json::Bool; out.number = 1; return literal("true"); }
+        if (c == 'f') { out.type = Json::Bool; return literal("false"); }
+        if (c == 'n') return literal("null");
+
+        char* end = nullptr;
+        out.number = strtod(in.c_str() + pos, &end);
+        if (end == in.c_str() + pos) return fail("unexpected character");
+        out.type = Json::Number;
+        pos = end - in.c_str();
+        return true;
+    }
+};
+
+
+/* --------------------------------------------------------------- Content */
+
+struct Color {
+    uint8_t r, g, b;
+    bool operator==(const Color& o) const { return r == o.r && g == o.g && b == o.b; }
+    bool operator!=(const Color& o) const { return !(*this == o); }
+    uint32_t key() const { return (r << 16) | (g << 8) | b; }
+};
+
+struct Entry {
+    uint16_t index;
+    Color color;
+};
+
+using SparseFrame = std::vector<Entry>;
+
+struct Source {
+    std::string name;
+    uint16_t totalPixels = 0;
+    uint16_t width = 0;
+    std::vector<SparseFrame> frames;
+    std::vector<uint32_t> frameTimes;   // Empty without a timeline
+    uint32_t durationMs = 0;
+    size_t jsonBytes = 0;
+};
+
+static bool readSource(const std::string& path, Source& source, std::string& error) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        error = "cannot open";
+        return false;
+    }
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    const std::string text = buffer.str();
+    source.jsonBytes = text.size();
+
+    Json doc;
+    JsonParser parser(text);
+    if (!parser.value(doc)) {
+        error = parser.error;
+        return false;
+    }
+
+    const Json& metadata = doc["metadata"];
+    if (metadata["name"].type != Json::String || metadata["total_pixels"].type != Json::Number) {
+        error = "invalid or missing metadata";
+        return false;
+    }
+    source.name = metadata["name"].text;
+    source.totalPixels = static_cast<uint16_t>(metadata["total_pixels"].asInt());
+    source.width = static_cast<uint16_t>(metadata["width"].asInt(0));
+    source.durationMs = static_cast<uint32_t>(metadata["duration_ms"].asInt(0));
+
+    for (const Json& framejson : doc["frames"].items) {
+        SparseFrame frame;
+        for (const Json& pixel : framejson.items) {
+            if (pixel.items.size() != 4) {
+                error = "invalid pixel data format";
+                return false;
+            }
+            frame.push_back({
+                static_cast<uint16_t>(pixel.items[0].asInt()),
+                {static_cast<uint8_t>(pixel.items[1].asInt()),
+                 static_cast<uint8_t>(pixel.items[2].asInt()),
+                 static_cast<uint8_t>(pixel.items[3].asInt())}
+            });
+        }
+        source.frames.push_back(std::move(frame));
+    }
+
+    for (const Json& time : doc["timestamps"].items) source.frameTimes.push_back(static_cast<uint32_t>(time.asInt()));
+    if (!source.frameTimes.empty() && source.frameTimes.size() != source.frames.size()) {
+        error = "timestamps do not match the frames";
+        return false;
+    }
+    return true;
+}
+
+
+/* ------------------------------------------------------------- Transforms */
+
+/**
+ * Sort each frame by LED and keep only the last write to each LED, which is
+ * what the renderer ends up showing.
+ */
+static void normalize(std::vector<SparseFrame>& frames) {
+    for (SparseFrame& frame : frames) {
+        std::stable_sort(frame.begin(), frame.end(), [](const Entry& a, const Entry& b) { return a.index < b.index; });
+        SparseFrame unique;
+        for (const Entry& entry : frame) {
+            if (!unique.empty() && unique.back().index == entry.index) unique.back() = entry;
+            else unique.push_back(entry);
+        }
+        frame.swap(unique);
+    }
+}
+
+/**
+ * Drop writes that do not change the strip. Frames are drawn over the previous
+ * one, so a write is redundant if an earlier frame of the same cycle already left
+ * that color. The first frame is kept whole: what it draws over differs between
+ * the first play and a repeat.
+ */
+static void pruneDeltas(std::vector<SparseFrame>& frames) {
+    std::unordered_map<uint16_t, Color> shown;
+    for (SparseFrame& frame : frames) {
+        SparseFrame changed;
+        for (const Entry& entry : frame) {
+            auto it = shown.find(entry.index);
+            if (it == shown.end() || it->second != entry.color) changed.push_back(entry);
+        }
+        for (const Entry& entry : frame) shown[entry.index] = entry.color;
+        frame.swap(changed);
+    }
+}
+
+/**
+ * Check if every frame is mirror symmetric across the middle of its rows.
+ */
+static bool isMirrored(const std::vector<SparseFrame>& frames, uint16_t width) {
+    if (width < 2) return false;
+    for (const SparseFrame& frame : frames) {
+        std::unordered_map<uint16_t, Color> colors;
+        for (const Entry& entry : frame) colors[entry.index] = entry.color;
+        for (const Entry& entry : frame) {
+            const uint16_t x = entry.index % width;
+            const uint16_t mirrored = entry.index - x + (width - 1 - x);
+            auto it = colors.find(mirrored);
+            if (it == colors.end() || it->second != entry.color) return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Keep the left half of each row, the center column included.
+ */
+static void keepLeftHalf(std::vector<SparseFrame>& frames, uint16_t width) {
+    for (SparseFrame& frame : frames) {
+        SparseFrame half;
+        for (const Entry& entry : frame) {
+            if (entry.index % width <= (width - 1) / 2) half.push_back(entry);
+        }
+        frame.swap(half);
+    }
+}
+
+
+/* --------------------------------------------------------------- Encoding */
+
+struct Options {
+    bool delta = false;
+    bool dedup = false;
+    bool spans = false;
+    bool palette = false;
+    bool mirror = false;
+    bool lz = false;
+};
+
+struct Encoded {
+    std::vector<uint8_t> file;
+    size_t payloadBytes = 0;
+    size_t uniqueFrames = 0;
+    size_t devicePixels = 0;    // Sparse entries on the device after decoding
+    size_t colors = 0;
+};
+
+static void put8(std::vector<uint8_t>& out, uint8_t v) { out.push_back(v); }
+static void put16(std::vector<uint8_t>& out, uint16_t v) { out.push_back(v & 0xFF); out.push_back(v >> 8); }
+static void put32(std::vector<uint8_t>& out, uint32_t v) { put16(out, v & 0xFFFF); put16(out, v >> 16); }
+
+/**
+ * LZ compressor for animLzDecompress: greedy matching through a hash of 4-byte sequences.
+ */
+static std::vector<uint8_t> lzCompress(const std::vector<uint8_t>& in) {
+    std::vector<uint8_t> out;
+    std::vector<int64_t> table(1 << 14, -1);
+    size_t anchor = 0;
+    size_t ip = 0;
+
+    auto putLength = [&out](size_t length) {
+        while (length >= 255) { out.push_back(255); length -= 255; }
+        out.push_back(static_cast<uint8_t>(length));
+    };
+    auto emit = [&](size_t literals, size_t offset, size_t match) {
+        const uint8_t litNibble = literals >= 15 ? 15 : static_cast<uint8_t>(literals);
+        const uint8_t matchNibble = match == 0 ? 0 : (match - 4 >= 15 ? 15 : static_cast<uint8_t>(match - 4));
+        out.push_back((litNibble << 4) | matchNibble);
+        if (literals >= 15) putLength(literals - 15);
+        out.insert(out.end(), in.begin() + anchor, in.begin() + anchor + literals);
+        if (match == 0) return;
+        put16(out, static_cast<uint16_t>(offset));
+        if (match - 4 >= 15) putLength(match - 4 - 15);
+    };
+
+    while (ip + 4 <= in.size()) {
+        uint32_t sequence;
+        memcpy(&sequence, &in[ip], 4);
+        const uint32_t hash = (sequence * 2654435761u) >> 18;
+        const int64_t candidate = table[hash];
+        table[hash] = static_cast<int64_t>(ip);
+
+        if (candidate >= 0 && ip - candidate <= 0xFFFF && memcmp(&in[candidate], &in[ip], 4) == 0) {
+            size_t match = 4;
+            while (ip + match < in.size() && in[candidate + match] == in[ip + match]) match++;
+            emit(ip - anchor, ip - candidate, match);
+            ip += match;
+            anchor = ip;
+        } else {
+            ip++;
+        }
+    }
+
+    if (anchor < in.size() || out.empty()) emit(in.size() - anchor, 0, 0);
+    return out;
+}
+
+static Encoded encode(const Source& source, const Options& options) {
+    std::vector<SparseFrame> frames = source.frames;
+    normalize(frames);
+    if (options.delta) pruneDeltas(frames);
+
+    Encoded result;
+    for (const SparseFrame& frame : frames) result.devicePixels += frame.size();
+    if (options.mirror) keepLeftHalf(frames, source.width);
+
+    // Palette in order of first use
+    std::map<uint32_t, uint8_t> paletteIndex;
+    std::vector<Color> palette;
+    for (const SparseFrame& frame : frames) {
+        for (const Entry& entry : frame) {
+            if (paletteIndex.count(entry.color.key())) continue;
+            paletteIndex[entry.color.key()] = static_cast<uint8_t>(palette.size());
+            palette.push_back(entry.color);
+        }
+    }
+    result.colors = palette.size();
+    const bool usePalette = options.palette && palette.size() <= 256;
+
+    // Spans of each frame, then the frames deduplicated by their encoded bytes
+    std::vector<std::vector<uint8_t>> uniqueFrames;
+    std::map<std::vector<uint8_t>, uint16_t> frameIds;
+    std::vector<uint16_t> table;
+    for (const SparseFrame& frame : frames) {
+        std::vector<uint8_t> bytes;
+        uint16_t spanCount = 0;
+        put16(bytes, 0);
+        for (size_t i = 0; i < frame.size();) {
+            size_t length = 1;
+            if (options.spans) {
+                while (i + length < frame.size() && length < 255 &&
+                       frame[i + length].index == frame[i].index + length &&
+                       frame[i + length].color == frame[i].color) length++;
+            }
+            put16(bytes, frame[i].index);
+            put8(bytes, static_cast<uint8_t>(length));
+            if (usePalette) {
+                put8(bytes, paletteIndex[frame[i].color.key()]);
+            } else {
+                put8(bytes, frame[i].color.r);
+                put8(bytes, frame[i].color.g);
+                put8(bytes, frame[i].color.b);
+            }
+            spanCount++;
+            i += length;
+        }
+        bytes[0] = spanCount & 0xFF;
+        bytes[1] = spanCount >> 8;
+
+        auto known = frameIds.find(bytes);
+        if (options.dedup && known != frameIds.end()) {
+            table.push_back(known->second);
+        } else {
+            const uint16_t id = static_cast<uint16_t>(uniqueFrames.size());
+            if (options.dedup) frameIds[bytes] = id;
+            uniqueFrames.push_back(std::move(bytes));
+            table.push_back(id);
+        }
+    }
+    result.uniqueFrames = uniqueFrames.size();
+
+    std::vector<uint8_t> payload;
+    if (usePalette) {
+        put16(payload, static_cast<uint16_t>(palette.size()));
+        for (const Color& color : palette) {
+            put8(payload, color.r);
+            put8(payload, color.g);
+            put8(payload, color.b);
+        }
+    }
+    for (uint16_t id : table) put16(payload, id);
+    if (!source.frameTimes.empty()) {
+        for (uint32_t time : source.frameTimes) put32(payload, time);
+        put32(payload, source.durationMs);
+    }
+    for (const std::vector<uint8_t>& bytes : uniqueFrames) payload.insert(payload.end(), bytes.begin(), bytes.end());
+    result.payloadBytes = payload.size();
+
+    std::vector<uint8_t> stored = options.lz ? lzCompress(payload) : payload;
+
+    AnimFileHeader header = {};
+    header.magic = ANIM_MAGIC;
+    header.version = ANIM_VERSION;
+    header.flags = (usePalette ? ANIM_FLAG_PALETTE : 0) |
+                   (options.mirror ? ANIM_FLAG_MIRROR : 0) |
+                   (options.lz ? ANIM_FLAG_LZ : 0) |
+                   (source.frameTimes.empty() ? 0 : ANIM_FLAG_TIMELINE);
+    header.frameCount = static_cast<uint16_t>(table.size());
+    header.uniqueFrames = static_cast<uint16_t>(uniqueFrames.size());
+    header.totalPixels = source.totalPixels;
+    header.width = source.width;
+    header.payloadBytes = static_cast<uint32_t>(payload.size());
+    header.storedBytes = static_cast<uint32_t>(stored.size());
+    header.nameLength = static_cast<uint8_t>(std::min<size_t>(source.name.size(), 255));
+
+    const uint8_t* headerBytes = reinterpret_cast<const uint8_t*>(&header);
+    result.file.assign(headerBytes, headerBytes + sizeof(header));
+    result.file.insert(result.file.end(), source.name.begin(), source.name.begin() + header.nameLength);
+    result.file.insert(result.file.end(), stored.begin(), stored.end());
+    return result;
+}
+
+
+/* ----------------------------------------------------------- Verification */
+
+/**
+ * Decode a file the way the device does and compare the final strip state after
+ * every frame with the source. Mirrors the decoder in animformat.cpp.
+ */
+static bool verify(const Source& source, const std::vector<uint8_t>& file, std::string& error) {
+    AnimFileHeader header;
+    memcpy(&header, file.data(), sizeof(header));
+    const uint8_t* stored = file.data() + sizeof(header) + header.nameLength;
+
+    std::vector<uint8_t> payload(header.payloadBytes);
+    if (header.flags & ANIM_FLAG_LZ) {
+        if (!animLzDecompress(stored, header.storedBytes, payload.data(), payload.size())) {
+            error = "LZ stream does not decompress";
+            return false;
+        }
+    } else {
+        memcpy(payload.data(), stored, payload.size());
+    }
+
+    size_t pos = 0;
+    auto get8 = [&]() { return payload[pos++]; };
+    auto get16 = [&]() { uint16_t v = payload[pos] | (payload[pos + 1] << 8); pos += 2; return v; };
+
+    std::vector<Color> palette;
+    if (header.flags & ANIM_FLAG_PALETTE) {
+        palette.resize(get16());
+        for (Color& color : palette) color = {get8(), get8(), get8()};
+    }
+    std::vector<uint16_t> table(header.frameCount);
+    for (uint16_t& id : table) id = get16();
+    if (header.flags & ANIM_FLAG_TIMELINE) pos += 4 * (header.frameCount + 1);
+
+    std::vector<SparseFrame> unique(header.uniqueFrames);
+    for (SparseFrame& frame : unique) {
+        const uint16_t spans = get16();
+        for (uint16_t s = 0; s < spans; s++) {
+            const uint16_t first = get16();
+            const uint8_t length = get8();
+            Color color = (header.flags & ANIM_FLAG_PALETTE) ? palette[get8()] : Color{get8(), get8(), get8()};
+            for (uint16_t i = 0; i < length; i++) {
+                const uint16_t index = first + i;
+                frame.push_back({index, color});
+                if (!(header.flags & ANIM_FLAG_MIRROR)) continue;
+                const uint16_t x = index % header.width;
+                const uint16_t mirrored = header.width - 1 - x;
+                if (mirrored != x) frame.push_back({static_cast<uint16_t>(index - x + mirrored), color});
+            }
+        }
+    }
+    if (pos != payload.size()) {
+        error = "payload size mismatch";
+        return false;
+    }
+
+    // Play both twice from a blank strip, the second pass checks repeats
+    std::unordered_map<uint16_t, uint32_t> expected, actual;
+    for (int pass = 0; pass < 2; pass++) {
+        for (size_t f = 0; f < source.frames.size(); f++) {
+            for (const Entry& entry : source.frames[f]) expected[entry.index] = entry.color.key();
+            for (const Entry& entry : unique[table[f]]) actual[entry.index] = entry.color.key();
+            if (expected != actual) {
+                error = "frame " + std::to_string(f) + " differs from the source";
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+
+/* ----------------------------------------------------------------- Report */
+
+static double loadMs(const Encoded& encoded, bool lz) {
+    const double readUs = encoded.file.size() / FLASH_BYTES_PER_US;
+    const double lzUs = lz ? encoded.payloadBytes * LZ_NS_PER_BYTE / 1000.0 : 0;
+    const double decodeUs = encoded.devicePixels * DECODE_NS_PER_PIXEL / 1000.0;
+    return (readUs + lzUs + decodeUs) / 1000.0;
+}
+
+static double composeUs(const Source& source, size_t pixels) {
+    return source.frames.empty() ? 0 : pixels * COMPOSE_NS_PER_PIXEL / 1000.0 / source.frames.size();
+}
+
+static bool processFile(const std::string& path, const std::string& outDir, bool write) {
+    Source source;
+    std::string error;
+    if (!readSource(path, source, error)) {
+        fprintf(stderr, "%s: %s\n", path.c_str(), error.c_str());
+        return false;
+    }
+
+    size_t sourcePixels = 0;
+    for (const SparseFrame& frame : source.frames) sourcePixels += frame.size();
+
+    printf("%s: '%s', %zu frames, %zu pixel entries\n", path.c_str(), source.name.c_str(), source.frames.size(), sourcePixels);
+    printf("  %-10s %10s %10s %14s  %s\n", "encoding", "bytes", "load ms", "compose us/fr", "notes");
+    printf("  %-10s %10zu %10.1f %14.2f\n", "json", source.jsonBytes,
+           (source.jsonBytes / FLASH_BYTES_PER_US + source.jsonBytes * JSON_NS_PER_BYTE / 1000.0) / 1000.0,
+           composeUs(source, sourcePixels));
+
+    // Apply each step on top of the previous ones, keep it only if the file shrinks
+    Options options;
+    Encoded best = encode(source, options);
+    printf("  %-10s %10zu %10.1f %14.2f\n", "sparse", best.file.size(), loadMs(best, false), composeUs(source, best.devicePixels));
+
+    struct Step {
+        const char* name;
+        bool Options::*flag;
+        bool applicable;
+        std::string note;
+    };
+    std::vector<Step> steps = {
+        {"+delta", &Options::delta, true, ""},
+        {"+dedup", &Options::dedup, true, ""},
+        {"+rle", &Options::spans, true, ""},
+        {"+palette", &Options::palette, best.colors <= 256, std::to_string(best.colors) + " colors"},
+        {"+mirror", &Options::mirror, false, "not symmetric"},
+        {"+lz", &Options::lz, true, ""},
+    };
+
+    for (Step& step : steps) {
+        if (step.flag == &Options::mirror) {
+            std::vector<SparseFrame> frames = source.frames;
+            normalize(frames);
+            if (options.delta) pruneDeltas(frames);
+            step.applicable = isMirrored(frames, source.width);
+            if (step.applicable) step.note = "rows of " + std::to_string(source.width);
+        }
+        if (!step.applicable) {
+            printf("  %-10s %10s %10s %14s  %s\n", step.name, "-", "-", "-", step.note.c_str());
+            continue;
+        }
+
+        Options trial = options;
+        trial.*step.flag = true;
+        const Encoded encoded = encode(source, trial);
+        const bool kept = encoded.file.size() < best.file.size();
+        // The loader copies a repeated frame out once per use, only the file gets smaller
+        if (step.flag == &Options::dedup) step.note = std::to_string(encoded.uniqueFrames) + " distinct frames, file size only";
+        printf("  %-10s %10zu %10.1f %14.2f  %s%s\n", step.name, encoded.file.size(), loadMs(encoded, trial.lz),
+               composeUs(source, encoded.devicePixels), step.note.c_str(), kept ? "" : (step.note.empty() ? "not kept" : ", not kept"));
+        if (kept) {
+            options = trial;
+            best = encoded;
+        }
+    }
+
+    if (!verify(source, best.file, error)) {
+        fprintf(stderr, "%s: verification failed, %s\n", path.c_str(), error.c_str());
+        return false;
+    }
+
+    std::string base = path.substr(path.find_last_of("/\\") + 1);
+    if (base.size() > 5 && base.compare(base.size() - 5, 5, ".json") == 0) base.resize(base.size() - 5);
+    const std::string dir = outDir.empty() ? path.substr(0, path.find_last_of("/\\") + 1) : outDir + "/";
+    const std::string output = dir + base + ANIM_FILE_SUFFIX;
+
+    printf("  chosen: %zu bytes, %.1fx smaller than JSON, %.0f%% of the JSON load time\n", best.file.size(),
+           static_cast<double>(source.jsonBytes) / best.file.size(),
+           100.0 * loadMs(best, options.lz) /
+               ((source.jsonBytes / FLASH_BYTES_PER_US + source.jsonBytes * JSON_NS_PER_BYTE / 1000.0) / 1000.0));
+
+    if (!write) return true;
+    std::ofstream out(output, std::ios::binary);
+    out.write(reinterpret_cast<const char*>(best.file.data()), best.file.size());
+    if (!out) {
+        fprintf(stderr, "%s: cannot write\n", output.c_str());
+        return false;
+    }
+    printf("  wrote %s\n", output.c_str());
+    return true;
+}
+
+
+int main(int argc, char** argv) {
+    std::string outDir;
+    bool write = true;
+    std::vector<std::string> files;
+
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg == "-o" && i + 1 < argc) outDir = argv[++i];
+        else if (arg == "-n") write = false;
+        else if (!arg.empty() && arg[0] == '-') {
+            fprintf(stderr, "unknown option %s\n", arg.c_str());
+            return 2;
+        }
+        else files.push_back(arg);
+    }
+
+    if (files.empty()) {
+        fprintf(stderr, "usage: animopt [-o DIR] [-n] FILE.json...\n");
+        return 2;
+    }
+
+    bool ok = true;
+    for (const std::string& file : files) ok = processFile(file, outDir, write) && ok;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,242 @@
+/**
+ * kernelcheck - host check and benchmark of the pixel kernels in kernels.h
+ *
+ * Runs every kernel entry point against its *Reference on exhaustive channel values
+ * and on random lengths, buffer offsets and weights, and fails on the first byte that
+ * differs. On the host the SWAR word paths are built, the PIE paths need an ESP32-S3,
+ * where checkKernels() runs at boot with KERNEL_CHECK defined in io.h.
+ *
+ * Build (any C++17 compiler, no dependencies):
+ *     g++ -std=c++17 -O2 -I. -o kernelcheck tools/kernelcheck/kernelcheck.cpp kernels.cpp
+ *
+ * Usage:
+ *     kernelcheck [-b] [-s SEED] [-n ROUNDS]
+ *         -b        Also time a frame compose with the kernels and with the references
+ *         -s SEED   Seed of the random cases
+ *         -n ROUNDS Number of random cases per kernel, 20000 by default
+ */
+
+#include "../../kernels.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+
+// Largest random case, in bytes, and the most a buffer is offset from alignment
+static const size_t MAX_BYTES = 1000;
+static const size_t MAX_OFFSET = 31;
+
+
+static std::mt19937 rng;
+
+static size_t randomBelow(size_t bound) {
+    return std::uniform_int_distribution<size_t>(0, bound - 1)(rng);
+}
+
+static void fill(uint8_t* data, size_t bytes) {
+    for (size_t i = 0; i < bytes; i++) data[i] = static_cast<uint8_t>(rng());
+}
+
+/**
+ * Weights and scales, the edges more often than a uniform draw would
+ */
+static uint8_t randomWeight() {
+    static const uint8_t edges[] = {0, 1, 127, 128, 254, 255};
+    return randomBelow(4) == 0 ? edges[randomBelow(sizeof(edges))] : static_cast<uint8_t>(rng());
+}
+
+static bool same(const char* kernel, const uint8_t* got, const uint8_t* want, size_t bytes, const std::string& detail) {
+    for (size_t i = 0; i < bytes; i++) {
+        if (got[i] == want[i]) continue;
+        fprintf(stderr, "%s: byte %zu is %u, the reference gives %u (%s)\n", kernel, i, got[i], want[i], detail.c_str());
+        return false;
+    }
+    return true;
+}
+
+static std::string describe(size_t bytes, size_t offsetA, size_t offsetB, unsigned weight) {
+    return "bytes " + std::to_string(bytes) + ", offsets " + std::to_string(offsetA) + "/" + std::to_string(offsetB) +
+           ", weight " + std::to_string(weight);
+}
+
+
+/* ------------------------------------------------------------ exhaustive */
+
+/**
+ * Every channel value, or pair of values, through every scale and weight
+ */
+static bool checkExhaustive() {
+    std::vector<uint8_t> a(65536), b(65536), got(65536), want(65536);
+    for (size_t i = 0; i < 65536; i++) {
+        a[i] = static_cast<uint8_t>(i);
+        b[i] = static_cast<uint8_t>(i >> 8);
+    }
+
+    for (unsigned w = 0; w < 256; w++) {
+        const std::string detail = "exhaustive, weight " + std::to_string(w);
+
+        memcpy(got.data(), a.data(), 256);
+        memcpy(want.data(), a.data(), 256);
+        scalePixels(got.data(), 256, static_cast<uint8_t>(w));
+        scalePixelsReference(want.data(), 256, static_cast<uint8_t>(w));
+        if (!same("scalePixels", got.data(), want.data(), 256, detail)) return false;
+
+        lerpPixels(got.data(), a.data(), b.data(), 65536, static_cast<uint8_t>(w));
+        lerpPixelsReference(want.data(), a.data(), b.data(), 65536, static_cast<uint8_t>(w));
+        if (!same("lerpPixels", got.data(), want.data(), 65536, detail)) return false;
+    }
+
+    memcpy(got.data(), a.data(), 65536);
+    memcpy(want.data(), a.data(), 65536);
+    addPixels(got.data(), b.data(), 65536);
+    addPixelsReference(want.data(), b.data(), 65536);
+    return same("addPixels", got.data(), want.data(), 65536, "exhaustive");
+}
+
+
+/* ---------------------------------------------------------------- random */
+
+static bool checkRandom(size_t rounds) {
+    // Room for the largest case at the largest offset, with guard bytes after it
+    const size_t span = MAX_BYTES + MAX_OFFSET + 64;
+    std::vector<uint8_t> a(span), b(span), got(span), want(span);
+
+    for (size_t round = 0; round < rounds; round++) {
+        const size_t bytes = randomBelow(MAX_BYTES + 1);
+        const size_t offsetA = randomBelow(MAX_OFFSET + 1);
+        // Half the cases share the alignment phase and reach the word or vector loop
+        const size_t offsetB = randomBelow(2) == 0 ? offsetA : randomBelow(MAX_OFFSET + 1);
+        const uint8_t weight = randomWeight();
+        const std::string detail = describe(bytes, offsetA, offsetB, weight);
+        fill(a.data(), span);
+        fill(b.data(), span);
+
+        // In place kernels start from the same bytes, guards included
+        fill(got.data(), span);
+        want = got;
+        scalePixels(got.data() + offsetA, bytes, weight);
+        scalePixelsReference(want.data() + offsetA, bytes, weight);
+        if (!same("scalePixels", got.data(), want.data(), span, detail)) return false;
+
+        fill(got.data(), span);
+        want = got;
+        addPixels(got.data() + offsetA, b.data() + offsetB, bytes);
+        addPixelsReference(want.data() + offsetA, b.data() + offsetB, bytes);
+        if (!same("addPixels", got.data(), want.data(), span, detail)) return false;
+
+        fill(got.data(), span);
+        want = got;
+        lerpPixels(got.data() + offsetA, a.data() + offsetA, b.data() + offsetB, bytes, weight);
+        lerpPixelsReference(want.data() + offsetA, a.data() + offsetA, b.data() + offsetB, bytes, weight);
+        if (!same("lerpPixels", got.data(), want.data(), span, detail)) return false;
+
+        // The output is allowed to be either input
+        fill(got.data(), span);
+        want = got;
+        blendPixels(got.data() + offsetA, b.data() + offsetB, bytes, weight);
+        lerpPixelsReference(want.data() + offsetA, want.data() + offsetA, b.data() + offsetB, bytes, weight);
+        if (!same("blendPixels", got.data(), want.data(), span, detail)) return false;
+
+        fill(got.data(), span);
+        want = got;
+        lerpPixels(got.data() + offsetA, a.data() + offsetB, got.data() + offsetA, bytes, weight);
+        lerpPixelsReference(want.data() + offsetA, a.data() + offsetB, want.data() + offsetA, bytes, weight);
+        if (!same("lerpPixels into b", got.data(), want.data(), span, detail)) return false;
+    }
+    return true;
+}
+
+
+/* ------------------------------------------------------------- benchmark */
+
+struct ComposeKernels {
+    void (*scale)(uint8_t*, size_t, uint8_t);
+    void (*add)(uint8_t*, const uint8_t*, size_t);
+    void (*lerp)(uint8_t*, const uint8_t*, const uint8_t*, size_t, uint8_t);
+};
+
+/**
+ * Time one frame compose in the app: crossfade two frames, dim and add a glow layer,
+ * the work that runs before writeRgb()
+ * @return Nanoseconds per frame
+ */
+static double timeCompose(const ComposeKernels& kernels, size_t leds, uint32_t& checksum) {
+    const size_t bytes = leds * 3;
+    std::vector<uint8_t> from(bytes), to(bytes), glow(bytes), mix(bytes);
+    fill(from.data(), bytes);
+    fill(to.data(), bytes);
+    fill(glow.data(), bytes);
+
+    const int frames = static_cast<int>(std::max<size_t>(50, 20000000 / bytes));
+    const auto start = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < frames; frame++) {
+        kernels.lerp(mix.data(), from.data(), to.data(), bytes, static_cast<uint8_t>(frame));
+        kernels.scale(mix.data(), bytes, 200);
+        kernels.add(mix.data(), glow.data(), bytes);
+        checksum += mix[frame % bytes];
+    }
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / frames;
+}
+
+static void benchmark() {
+    static const ComposeKernels fast = {scalePixels, addPixels, lerpPixels};
+    static const ComposeKernels reference = {scalePixelsReference, addPixelsReference, lerpPixelsReference};
+    uint32_t checksum = 0;
+
+    printf("\nCompose per frame on this host, lerp + scale + add:\n");
+    printf("%8s %14s %14s %8s\n", "LEDs", "kernels us", "reference us", "ratio");
+    for (size_t leds : {100, 1024, 5000}) {
+        const double fastNs = timeCompose(fast, leds, checksum);
+        const double referenceNs = timeCompose(reference, leds, checksum);
+        printf("%8zu %14.2f %14.2f %7.2fx\n", leds, fastNs / 1000.0, referenceNs / 1000.0, referenceNs / fastNs);
+    }
+    printf("(checksum %u) Host timings only, the compiler may vectorize the references here;\n", checksum);
+    printf("measure on the board with PlaybackTelemetry::lastFrameUs.\n");
+}
+
+
+int main(int argc, char** argv) {
+    bool bench = false;
+    unsigned long seed = 1;
+    size_t rounds = 20000;
+
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg == "-b") bench = true;
+        else if (arg == "-s" && i + 1 < argc) seed = strtoul(argv[++i], nullptr, 0);
+        else if (arg == "-n" && i + 1 < argc) rounds = strtoul(argv[++i], nullptr, 0);
+        else {
+            fprintf(stderr, "usage: kernelcheck [-b] [-s SEED] [-n ROUNDS]\n");
+            return 2;
+        }
+    }
+    rng.seed(seed);
+
+#ifdef KERNELS_PIE
+    printf("Checking the PIE kernels\n");
+#else
+    printf("Checking the SWAR kernels\n");
+#endif
+    if (!checkExhaustive() || !checkRandom(rounds)) {
+        printf("FAILED, seed %lu\n", seed);
+        return 1;
+    }
+
+    // The check the board runs with KERNEL_CHECK, so it is known to pass before it is flashed
+    const char* failed = checkKernels(static_cast<uint32_t>(seed));
+    if (failed != nullptr) {
+        printf("FAILED, checkKernels() reports %s, seed %lu\n", failed, seed);
+        return 1;
+    }
+    printf("All kernels match their references, %zu random cases each, seed %lu\n", rounds, seed);
+
+    if (bench) benchmark();
+    return 0;
+}
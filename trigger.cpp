@@ -0,0 +1,35 @@
+#include "trigger.h"
+
+
+void IRAM_ATTR FrameTrigger::onEdge(void* arg) {
+    static_cast<FrameTrigger*>(arg)->fireFromIsr();
+}
+
+
+void FrameTrigger::attachGpio(uint8_t pin, int mode, uint8_t inputMode) {
+    detachGpio();
+    pinMode(pin, inputMode);
+    attachInterruptArg(digitalPinToInterrupt(pin), onEdge, this, mode);
+    gpio_ = pin;
+    debugf("Frame trigger on GPIO %d\n", pin);
+}
+
+
+void FrameTrigger::detachGpio() {
+    if (gpio_ < 0) return;
+    detachInterrupt(digitalPinToInterrupt(gpio_));
+    gpio_ = -1;
+}
+
+
+uint32_t FrameTrigger::pollStream(Stream& stream, uint8_t byte) {
+    uint32_t fired = 0;
+    while (stream.available() > 0) {
+        const int c = stream.read();
+        if (c < 0) break;
+        if (static_cast<uint8_t>(c) != byte) continue;
+        fire();
+        fired++;
+    }
+    return fired;
+}
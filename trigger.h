@@ -0,0 +1,172 @@
+#pragma once
+#ifndef TRIGGER_H
+#define TRIGGER_H
+
+#include "io.h"
+#include <Arduino.h>
+#include <esp_timer.h>
+#include <atomic>
+
+// Milliseconds the render task waits for a trigger before checking for stop or an animation change
+#define TRIGGER_POLL_MS 10
+
+// Beats further apart than this restart the tempo instead of slowing it down
+#define TRIGGER_MAX_BEAT_US 4000000
+
+
+enum class TriggerMode : uint8_t {
+    Step,       // Each trigger shows the next frame
+    Tempo       // Triggers are beats, frames are spread evenly between them
+};
+
+
+/**
+ * @brief External trigger that advances frames, e.g. a GPIO edge, a serial byte or the host
+ * @details fire() counts a trigger, measures the beat period and wakes the render task
+ * through its task notification, so the next frame goes out as soon as the render task
+ * runs, not on the next delay tick. Safe to fire from an ISR.
+ */
+class FrameTrigger {
+private:
+    std::atomic<uint32_t> pending_{0};      // Triggers not taken by the render task yet
+    std::atomic<uint32_t> lastUs_{0};       // Low 32 bits of the timer at the last trigger
+    std::atomic<uint32_t> periodUs_{0};     // Smoothed time between triggers, 0 until two arrived
+    std::atomic<TaskHandle_t> task_{nullptr};
+    int gpio_ = -1;
+
+    static void IRAM_ATTR onEdge(void* arg);
+
+    /**
+     * @brief Count a trigger and measure the beat period
+     */
+    inline void IRAM_ATTR count(uint32_t nowUs) {
+        const uint32_t last = lastUs_.exchange(nowUs, std::memory_order_relaxed);
+        const uint32_t interval = nowUs - last;
+        const uint32_t period = periodUs_.load(std::memory_order_relaxed);
+        if (last == 0 || interval > TRIGGER_MAX_BEAT_US) {
+            // First beat or a restart, keep the old tempo until the next interval
+        } else if (period == 0) {
+            periodUs_.store(interval, std::memory_order_relaxed);
+        } else {
+            // Follow tempo changes within a few beats without jumping on one late edge
+            periodUs_.store(period - period / 4 + interval / 4, std::memory_order_relaxed);
+        }
+        pending_.fetch_add(1, std::memory_order_release);
+    }
+
+public:
+    FrameTrigger() = default;
+    FrameTrigger(const FrameTrigger&) = delete;
+    FrameTrigger& operator=(const FrameTrigger&) = delete;
+
+    ~FrameTrigger() {
+        detachGpio();
+    }
+
+    /**
+     * @brief Fire on a GPIO edge
+     * @param pin The input pin
+     * @param mode RISING, FALLING or CHANGE
+     * @param inputMode INPUT or INPUT_PULLUP
+     */
+    void attachGpio(uint8_t pin, int mode = RISING, uint8_t inputMode = INPUT_PULLUP);
+
+    /**
+     * @brief Stop firing on the GPIO
+     */
+    void detachGpio();
+
+    /**
+     * @brief Fire from a task, e.g. on a serial byte or a network message
+     */
+    void fire() {
+        count(static_cast<uint32_t>(esp_timer_get_time()));
+        TaskHandle_t task = task_.load(std::memory_order_acquire);
+        if (task != nullptr) xTaskNotifyGive(task);
+    }
+
+    /**
+     * @brief Fire from an ISR
+     */
+    void IRAM_ATTR fireFromIsr() {
+        count(static_cast<uint32_t>(esp_timer_get_time()));
+        TaskHandle_t task = task_.load(std::memory_order_acquire);
+        if (task == nullptr) return;
+        BaseType_t woken = pdFALSE;
+        vTaskNotifyGiveFromISR(task, &woken);
+        portYIELD_FROM_ISR(woken);
+    }
+
+    /**
+     * @brief Fire once per matching byte waiting in a stream
+     * @param stream The stream to read, e.g. Serial
+     * @param byte The byte that fires, other bytes are dropped
+     * @return The number of triggers fired
+     * @details Call from the app task, the bytes are read there and not on the render task.
+     */
+    uint32_t pollStream(Stream& stream, uint8_t byte);
+
+    /**
+     * @brief Set the tempo directly, e.g. from a BPM the host sends
+     * @param bpm Beats per minute, 0 to learn it from the triggers again
+     */
+    void setBpm(float bpm) {
+        periodUs_.store(bpm > 0.0f ? static_cast<uint32_t>(60000000.0f / bpm) : 0, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Get the tempo
+     * @return Beats per minute, 0 until two triggers arrived or setBpm() was called
+     */
+    float getBpm() const {
+        const uint32_t period = periodUs_.load(std::memory_order_relaxed);
+        return period > 0 ? 60000000.0f / period : 0.0f;
+    }
+
+    /**
+     * @brief Get the beat period in microseconds, 0 if unknown
+     */
+    uint32_t beatPeriodUs() const {
+        return periodUs_.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Get the timer value of the last trigger, low 32 bits of esp_timer_get_time()
+     */
+    uint32_t lastTriggerUs() const {
+        return lastUs_.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Make the calling task the one woken by triggers, from the render task
+     * @details Triggers that arrived before are dropped, playback starts on the next one.
+     */
+    void bind() {
+        pending_.store(0, std::memory_order_relaxed);
+        task_.store(xTaskGetCurrentTaskHandle(), std::memory_order_release);
+    }
+
+    /**
+     * @brief Stop waking the render task
+     */
+    void unbind() {
+        task_.store(nullptr, std::memory_order_release);
+    }
+
+    /**
+     * @brief Take the triggers that arrived since the last call
+     */
+    uint32_t take() {
+        return pending_.exchange(0, std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Block the bound task until a trigger arrives
+     * @param waitTicks The longest to wait
+     */
+    void wait(TickType_t waitTicks) {
+        if (pending_.load(std::memory_order_acquire) == 0) ulTaskNotifyTake(pdTRUE, waitTicks);
+    }
+};
+
+#endif